@@ -2,7 +2,6 @@
 
 #include "common.h"
 #include "chunk.h"
-#include "disassembler.h"
 #include "mmemory.h"
 #include "register.h"
 
@@ -70,9 +69,8 @@ unsigned int typeCfg(ValueType type) {
 /* Initialization and conversion
 ============================= */
 
-/*Initialization - Zero the different terms */
-Instruction* initInstruction() {
-  Instruction* instruction = ALLOCATE_OBJ(Instruction);
+/* Zero the different terms */
+static void clearInstruction(Instruction* instruction) {
   instruction->op_code  = 0;
   instruction->cfg_mask = 0;
   instruction->rd = 0;
@@ -82,6 +80,21 @@ Instruction* initInstruction() {
   instruction->immb = 0;
   instruction->addr = 0;
   instruction->type = 0;
+}
+
+
+/*Initialization - Zero the different terms */
+Instruction* initInstruction() {
+  Instruction* instruction = ALLOCATE_OBJ(Instruction);
+  clearInstruction(instruction);
+  return instruction;
+}
+
+
+/* Bump allocation of an instruction, no free needed */
+Instruction* arenaInstruction(Arena* arena) {
+  Instruction* instruction = ARENA_OBJ(arena, Instruction);
+  clearInstruction(instruction);
   return instruction;
 }
 
@@ -339,26 +352,22 @@ uint32_t notInstruction(Instruction* instruction, unsigned int rd) {
     return instructionToUint32(instruction);
 }
 
-/* Direct Write
-============ */
+/* Register Transfers
+================== */
 
-/* Writes a store instruction from a register */
-void writeStoreFromRegister(Register* reg, Chunk* chunk) {
-  Instruction* strInstruction = initInstruction();
-  uint32_t bitStoreInstruction = storeInstruction(strInstruction, reg->number, reg->address, typeCfg(reg->varValue.type));
-  disassembleInstruction(bitStoreInstruction);
-  writeChunk(chunk, bitStoreInstruction);
-  freeInstruction(strInstruction);
+/* Store instruction of the variable held by a register */
+uint32_t storeFromRegister(Register* reg) {
+  Instruction strInstruction;
+  clearInstruction(&strInstruction);
+  return storeInstruction(&strInstruction, reg->number, reg->address, typeCfg(reg->varValue.type));
 }
 
 
-/* Writes a load instruction from a register */
-void writeLoadFromRegister(Register* reg, Chunk* chunk) {
-  Instruction* loadInstruction = initInstruction();
-  uint32_t bitLoadInstruction = loadInstructionAddr(loadInstruction, reg->number, reg->address, typeCfg(reg->varValue.type));
-  disassembleInstruction(bitLoadInstruction);
-  writeChunk(chunk, bitLoadInstruction);
-  freeInstruction(loadInstruction);
+/* Load instruction of the variable held by a register */
+uint32_t loadFromRegister(Register* reg) {
+  Instruction loadInstruction;
+  clearInstruction(&loadInstruction);
+  return loadInstructionAddr(&loadInstruction, reg->number, reg->address, typeCfg(reg->varValue.type));
 }
 
 /* NOP operation
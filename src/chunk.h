@@ -3,6 +3,7 @@
 #define sdvu_chunk_h
 
 #include "common.h"
+#include "mmemory.h"
 #include "register.h"
 #include "value.h"
 
@@ -47,6 +48,9 @@
 #define INT_SIZE   32
 #define STATE_SIZE 16
 
+/* Largest value held by an 11-bit immediate field */
+#define MAX_IMM 0x7FF
+
 /* Chunk of instructions definition */
 typedef struct {
   int count;              // Number of allocated entries in use
@@ -78,6 +82,8 @@ unsigned int typeCfg(ValueType type);
 
 /* Initialization struct initialization */
 Instruction* initInstruction();
+/* Instruction allocated in an arena, released with the arena */
+Instruction* arenaInstruction(Arena* arena);
 /* Free the given instruction */
 void freeInstruction(Instruction* instruction);
 /* Convert an instruction to a uint32_t counterpart */
@@ -100,12 +106,14 @@ uint32_t loadInstructionReg(Instruction* instruction, unsigned int rd, unsigned
 uint32_t loadInstructionImm(Instruction* instruction, unsigned int rd, unsigned int imma);
 /* Load from an address */
 uint32_t loadInstructionAddr(Instruction* instruction, unsigned int rd, unsigned int addr, unsigned int type);
+/* Load with the address held in a register */
+uint32_t loadInstructionRegAsAddr(Instruction* instruction, unsigned int rd, unsigned int ra, unsigned int type);
 /* Not instruction */
 uint32_t notInstruction(Instruction* instruction, unsigned int rd);
-/* Write a store instruction from a register */
-void writeStoreFromRegister(Register* reg, Chunk* chunk);
-/* Write a load instruction from a register */
-void writeLoadFromRegister(Register* reg, Chunk* chunk);
+/* Store instruction of the variable held by a register */
+uint32_t storeFromRegister(Register* reg);
+/* Load instruction of the variable held by a register */
+uint32_t loadFromRegister(Register* reg);
 /* Create a NOP instruction */
 uint32_t nopInstruction(Instruction* instruction);
 /* Create a ENDGA instruction */
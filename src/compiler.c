@@ -1,3 +1,4 @@
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
@@ -5,25 +6,25 @@
 
 #include "common.h"
 #include "compiler.h"
+#include "container.h"
 #include "disassembler.h"
+#include "image.h"
+#include "ir.h"
+#include "layout.h"
+#include "lower.h"
+#include "object.h"
+#include "optimizer.h"
+#include "partition.h"
 #include "scanner.h"
+#include "source.h"
 #include "sstring.h"
+#include "stream.h"
 #include "register.h"
 #include "table.h"
 #include "value.h"
 
-Compiler* compiler;
-
-/* Parser structure */
-typedef struct {
-  Token current;  /* current Token being investigated */
-  Token previous; /* next Token being investigated */
-  bool hadError;  /* Previous error was encountered */
-  bool panicMode; /* To avoid cascading errors */
-} Parser;
-
-/* Parser singleton */
-static Parser parser;
+/* Needed by the error recovery */
+static void advance(Compiler* compiler);
 
 typedef struct {
   int op_code;
@@ -101,45 +102,82 @@ static bool isBinOp(Token* tokenOperator) {
       ALLOCATION - DEALLOCATION
 =================================== */
 
-/* Compiler initialization */
-void initCompiler() {
-  compiler = ALLOCATE_OBJ(Compiler);
+/* Compilation state over a given globals table */
+static Compiler* newCompiler(Disassembler* disassembler, Table* globals) {
+  Compiler* compiler = ALLOCATE_OBJ(Compiler);
+  compiler->disassembler = disassembler;
   compiler->chunk     = initChunk();
-  compiler->globals   = initTable();
+  compiler->globals   = globals;
   compiler->registers = ALLOCATE_ARRAY(Register, REG_NUMBER);
   for (int i = 0 ; i < REG_NUMBER ; i++) {
-    compiler->registers[i] = *initRegister(i);
+    setRegister(&compiler->registers[i], i);
   }
-  compiler->topTempRegister = &compiler->registers[0];
-  compiler->topGlobRegister = &compiler->registers[REG_NUMBER-1];
   compiler->addressRegister = initRegister(REG_NUMBER);
+  compiler->location = NULL;
+  compiler->locationCapacity = 0;
+  compiler->ir = initIrProcess();
   compiler->pc = 0;
+  compiler->tokens = NULL;
+  compiler->next = 0;
+  compiler->image = NULL;
+  compiler->parser.hadError  = false;
+  compiler->parser.panicMode = false;
+  return compiler;
 }
 
 
-/* Compiler destruction */
-void freeCompiler() {
-  freeChunk(compiler->chunk);
-  freeTable(compiler->globals);
+/* Compiler initialization, the disassembler stays owned by the caller */
+Compiler* initCompiler(Disassembler* disassembler) {
+  Compiler* compiler = newCompiler(disassembler, initTable());
+  compiler->image = initStateImage();
+  return compiler;
+}
+
+
+/* Worker compiling processes on its own thread, the globals table and tokens are shared read-only */
+static Compiler* initWorker(Compiler* parent) {
+  Compiler* worker = newCompiler(parent->disassembler, parent->globals);
+  worker->tokens = parent->tokens;
+  worker->image = parent->image;
+  return worker;
+}
+
+
+/* Destruction of the state owned by a compiler or a worker */
+static void freeState(Compiler* compiler) {
+  if (compiler->chunk != NULL) freeChunk(compiler->chunk);
   freeRegister(compiler->addressRegister);
+  freeIrProcess(compiler->ir);
+  FREE(compiler->location);
   FREE(compiler->registers);
   FREE(compiler);
 }
 
 
+/* Compiler destruction, the names of the globals are owned by the compiler that declared them */
+void freeCompiler(Compiler* compiler) {
+  for (int i = 0 ; i < compiler->globals->symbolCount ; i++) {
+    if (compiler->globals->symbols[i].key != NULL) freeString(compiler->globals->symbols[i].key);
+  }
+  freeTable(compiler->globals);
+  freeStateImage(compiler->image);
+  freeState(compiler);
+}
+
+
 /* ==================================
            ERROR HANDLING
 =================================== */
 
 /* Synchronize the parser when it encounters an error*/
-static void synchronize() {
-  parser.panicMode = false;
+static void synchronize(Compiler* compiler) {
+  compiler->parser.panicMode = false;
   /* Look for a statement boundary */
-  while (parser.current.type != TOKEN_EOF) {
+  while (compiler->parser.current.type != TOKEN_EOF) {
     /* Look for an end notice */
-    if (parser.previous.type == TOKEN_SEMICOLON) return;
+    if (compiler->parser.previous.type == TOKEN_SEMICOLON) return;
     /* Look for the beginning of the next statement */
-    switch (parser.current.type) {
+    switch (compiler->parser.current.type) {
       case TOKEN_PROCESS:
       case TOKEN_GUARD_COND:
       case TOKEN_GUARD_BLOCK:
@@ -148,45 +186,45 @@ static void synchronize() {
         /* Do nothing */
         ;
     }
+    advance(compiler);
   }
 }
 
 
 /* Notifies the error with a message */
-static void errorAt(Token* token, const char* message) {
+static void errorAt(Compiler* compiler, Token* token, const char* message) {
   /* if PANIC MODE already triggered */
-  if (parser.panicMode) return;
+  if (compiler->parser.panicMode) return;
 
   /* Enter PANIC MODE */
-  parser.panicMode = true;
-
-  fprintf(stderr, "[line %d] Error", token->line);
+  compiler->parser.panicMode = true;
 
+  char location[64] = "";
   if (token->type == TOKEN_EOF) {
     /* Error at the end of the file*/
-    fprintf(stderr, " at end");
+    snprintf(location, sizeof(location), " at end");
   } else if (token->type == TOKEN_ERROR) {
     /*Nothing, actual error */
   } else {
     /* Print the token location where the error occured */
-    fprintf(stderr, " at '%.*s'", token->length, token->start);
+    snprintf(location, sizeof(location), " at '%.*s'", token->length, token->start);
   }
 
-  /* Print the actual error message */
-  fprintf(stderr, ": %s\n", message);
-  parser.hadError = true;
+  /* Print the actual error message, in a single write as workers report concurrently */
+  fprintf(stderr, "[line %d] Error%s: %s\n", token->line, location, message);
+  compiler->parser.hadError = true;
 }
 
 
 /* Notifies an error in the token just processed */
-static void error(const char* message) {
-  errorAt(&parser.previous, message);
+static void error(Compiler* compiler, const char* message) {
+  errorAt(compiler, &compiler->parser.previous, message);
 }
 
 
 /* Notifies an error in the current token */
-static void errorAtCurrent(const char* message) {
-  errorAt(&parser.current, message);
+static void errorAtCurrent(Compiler* compiler, const char* message) {
+  errorAt(compiler, &compiler->parser.current, message);
 }
 
 
@@ -197,139 +235,161 @@ static void errorAtCurrent(const char* message) {
 /* Utilities
 ========= */
 
+/* Next token, from the buffer if the source was tokenized beforehand */
+static Token nextToken(Compiler* compiler) {
+  if (compiler->tokens != NULL) return tokenAt(compiler->tokens, compiler->next++);
+  return scanToken(&compiler->scanner);
+}
+
+
 /* Advance the parser with a new non-error token handed over by the scanner */
-static void advance() {
-  parser.previous = parser.current;
+static void advance(Compiler* compiler) {
+  compiler->parser.previous = compiler->parser.current;
 
   /* Keep on reading until it finds a non-error token */
   for (;;) {
-    parser.current = scanToken();
+    compiler->parser.current = nextToken(compiler);
     /* Check for error */
-    if(parser.current.type != TOKEN_ERROR) break;
+    if(compiler->parser.current.type != TOKEN_ERROR) break;
     /* Report error */
-    errorAtCurrent(parser.current.start);
+    errorAtCurrent(compiler, compiler->parser.current.start);
 
   }
 }
 
 
 /* Expects the next token to be of a given type, else errors with given message */
-static void consume(TokenType type, const char* message) {
-  if (parser.current.type == type) {
-    advance();
+static void consume(Compiler* compiler, TokenType type, const char* message) {
+  if (compiler->parser.current.type == type) {
+    advance(compiler);
     return;
   }
-  errorAtCurrent(message);
+  errorAtCurrent(compiler, message);
 }
 
 
 /* Checks that the current token is of a given type */
-static bool check(TokenType type) {
-  return parser.current.type == type;
+static bool check(Compiler* compiler, TokenType type) {
+  return compiler->parser.current.type == type;
 }
 
 
 /* checks if the current token is of a given type */
-static bool match(TokenType type) {
+static bool match(Compiler* compiler, TokenType type) {
   /* If the type isnt correct, the token is NOT consumed */
-  if (!check(type)) return false;
+  if (!check(compiler, type)) return false;
   /* Otherwise token consumed */
-  advance();
+  advance(compiler);
   return true;
 }
 
-/* ==================================
-      BACK END - INSTRUCTIONS
-=================================== */
-
-/* Chunk Utilities
-=============== */
-
-/* Utility to increment the PC */
-static void incrementPC() {
-  if (compiler->pc == 0xFFFFFF) return;
-  compiler->pc += 1;
-}
-
 /* Values
 ====== */
 
-static void boolVal(String* varName, int length) {
+/* Set the initial value of the elements of a global from a given one to the last one */
+static void initialValues(Compiler* compiler, uint32_t address, uint32_t width, int from, int length, Value value) {
+  for (int i = from ; i < length ; i++) {
+    setImageValue(compiler->image, address + i * width, width, value);
+  }
+}
+
+static Value boolValue(Compiler* compiler) {
   /* Process Value */
   Value varValue = NIL_VAL;
-  if (match(TOKEN_TRUE)) {
+  if (match(compiler, TOKEN_TRUE)) {
     varValue = BOOL_VAL(true);
-  } else if (match(TOKEN_FALSE)) {
+  } else if (match(compiler, TOKEN_FALSE)) {
     varValue = BOOL_VAL(false);
   } else {
-    error("Boolean variable must be initialized with either 'true' or 'false'.");
+    error(compiler, "Boolean variable must be initialized with either 'true' or 'false'.");
   }
+  return varValue;
+}
+
+static void boolVal(Compiler* compiler, String* varName, int length) {
+  Value varValue = boolValue(compiler);
   /* Add to the globals table */
-  tableSet(compiler->globals, varName, varValue, compiler->globals->currentAddress);
+  uint32_t width = typeWidth(compiler->image, VAL_BOOL);
+  tableAppend(compiler->globals, varName, varValue, compiler->globals->currentAddress)->length = length;
+  initialValues(compiler, compiler->globals->currentAddress, width, 0, length, varValue);
   /* Update the current size with the added bool */
-  compiler->globals->currentAddress += BOOL_SIZE * length;
+  compiler->globals->currentAddress += width * length;
 }
 
-static void byteVal(String* varName, int length) {
+static Value byteValue(Compiler* compiler) {
   /* Process the actual value */
   Value varValue = NIL_VAL;
-  if (match(TOKEN_NUMBER)) {
-    double value = strtod(parser.previous.start, NULL);
+  if (match(compiler, TOKEN_NUMBER)) {
+    double value = strtod(compiler->parser.previous.start, NULL);
     if ((value < 0) || (value > 255)) {
-      error("Byte variable must be initialized with a number between 0 and 255.");
+      error(compiler, "Byte variable must be initialized with a number between 0 and 255.");
     }
     varValue = BYTE_VAL(value);
   } else {
-    error("Wrong type, byte variable must be initialized with a number between 0 and 255.");
+    error(compiler, "Wrong type, byte variable must be initialized with a number between 0 and 255.");
   }
+  return varValue;
+}
+
+static void byteVal(Compiler* compiler, String* varName, int length) {
+  Value varValue = byteValue(compiler);
   /* Add to the globals table */
-  tableSet(compiler->globals, varName, varValue, compiler->globals->currentAddress);
+  uint32_t width = typeWidth(compiler->image, VAL_BYTE);
+  tableAppend(compiler->globals, varName, varValue, compiler->globals->currentAddress)->length = length;
+  initialValues(compiler, compiler->globals->currentAddress, width, 0, length, varValue);
   /* Update the current size with the added byte */
-  compiler->globals->currentAddress += BYTE_SIZE * length;
+  compiler->globals->currentAddress += width * length;
 }
 
-static void intVal(String* varName, int length) {
+static Value intValue(Compiler* compiler) {
   /* Process Value */
   Value varValue = NIL_VAL;
-  if (match(TOKEN_NUMBER) || match(TOKEN_MINUS)) {
-    double value = strtod(parser.previous.start, NULL);
+  if (match(compiler, TOKEN_NUMBER) || match(compiler, TOKEN_MINUS)) {
+    double value = strtod(compiler->parser.previous.start, NULL);
     if ((value < INT16_MIN) || (value > INT16_MAX)) {
-      error("Int variable must be initialized with a number between -32768 and 32767.");
+      error(compiler, "Int variable must be initialized with a number between -32768 and 32767.");
     }
     varValue = INT_VAL(value);
   } else {
-    error("Wrong type, an int variable must be initialized with a number between -32768 and 32767.");
+    error(compiler, "Wrong type, an int variable must be initialized with a number between -32768 and 32767.");
   }
+  return varValue;
+}
+
+static void intVal(Compiler* compiler, String* varName, int length) {
+  Value varValue = intValue(compiler);
   /* Add to the globals table */
-  tableSet(compiler->globals, varName, varValue, compiler->globals->currentAddress);
+  uint32_t width = typeWidth(compiler->image, VAL_INT);
+  tableAppend(compiler->globals, varName, varValue, compiler->globals->currentAddress)->length = length;
+  initialValues(compiler, compiler->globals->currentAddress, width, 0, length, varValue);
   /* Update the current size with the added int */
-  compiler->globals->currentAddress += INT_SIZE * length;
+  compiler->globals->currentAddress += width * length;
 }
 
 /* Globals Declarations
 ==================== */
 
 /* Process global name */
-static void assignGlobalName(GlobalName* globName) {
+static void assignGlobalName(Compiler* compiler, GlobalName* globName) {
   String* varName = initString();
   int length = 0;
   /* Consume name */
-  consume(TOKEN_IDENTIFIER, "Expecting name after type in global declaration.");
-  assignString(varName, parser.previous.start, parser.previous.length);
+  consume(compiler, TOKEN_IDENTIFIER, "Expecting name after type in global declaration.");
+  assignString(varName, compiler->parser.previous.start, compiler->parser.previous.length);
   if (isTemp(varName->chars)) {
-    error("Variable names starting with 't_' are reserved for temporary variables.");
+    error(compiler, "Variable names starting with 't_' are reserved for temporary variables.");
   }
   /* Check for array definition */
-  if (match(TOKEN_LEFT_SQBRACKET)) {
-    if (check(TOKEN_NUMBER)) {
-      length = (int) strtol(parser.current.start, NULL, 0);
-      advance();
+  if (match(compiler, TOKEN_LEFT_SQBRACKET)) {
+    if (check(compiler, TOKEN_NUMBER)) {
+      length = (int) strtol(compiler->parser.current.start, NULL, 0);
+      advance(compiler);
     } else {
-      error("Array definition should have an index.");
+      error(compiler, "Array definition should have an index.");
     }
-    consume (TOKEN_RIGHT_SQBRACKET, "Expecting ']' after array length.");
+    consume(compiler, TOKEN_RIGHT_SQBRACKET, "Expecting ']' after array length.");
   }
-  consume(TOKEN_EQUAL, "Expecting variable initialization with '='.");
+  consume(compiler, TOKEN_EQUAL, "Expecting variable initialization with '='.");
   globName->name = varName;
   globName->isArray = (length != 0);
   globName->length = length;
@@ -337,694 +397,361 @@ static void assignGlobalName(GlobalName* globName) {
 
 
 /* Process bool global variable */
-static void globalBoolDeclaration() {
+static void globalBoolDeclaration(Compiler* compiler) {
   /* Process name and '=' */
   GlobalName* globName = initGlobalName();
-  assignGlobalName(globName);
+  assignGlobalName(compiler, globName);
   /* Test if the identifer is an array definition */
   if (!globName->isArray) { // Simple value
     /* Process Value */
-    boolVal(globName->name, 1);
+    boolVal(compiler, globName->name, 1);
   } else { // Array Declaration
-    consume(TOKEN_LEFT_BRACE, "Expecting '{' before array initialization.");
-    boolVal(globName->name, globName->length);
-    consume(TOKEN_RIGHT_BRACE, "Expecting '}' after array initialization.");
+    consume(compiler, TOKEN_LEFT_BRACE, "Expecting '{' before array initialization.");
+    uint32_t address = compiler->globals->currentAddress;
+    boolVal(compiler, globName->name, globName->length);
+    /* Each following value initializes the next element, the last one is kept up to the end */
+    for (int i = 1 ; i < globName->length && match(compiler, TOKEN_COMMA) ; i++) {
+      initialValues(compiler, address, typeWidth(compiler->image, VAL_BOOL), i, globName->length, boolValue(compiler));
+    }
+    while (!check(compiler, TOKEN_RIGHT_BRACE)) {
+      advance(compiler);
+    }
+    consume(compiler, TOKEN_RIGHT_BRACE, "Expecting '}' after array initialization.");
   }
-  consume(TOKEN_SEMICOLON, "Expecting ';' after variable declaration.");
+  consume(compiler, TOKEN_SEMICOLON, "Expecting ';' after variable declaration.");
+  /* The name is owned by the globals table now */
+  FREE(globName);
 }
 
 
 /* Process bool global variable */
-static void globalByteDeclaration() {
+static void globalByteDeclaration(Compiler* compiler) {
   /* Process name and '=' */
   GlobalName* globName = initGlobalName();
-  assignGlobalName(globName);
+  assignGlobalName(compiler, globName);
   /* Test if the identifer is an array definition */
   if (!globName->isArray) { // Simple value
     /* Process Value */
-    byteVal(globName->name, 1);
+    byteVal(compiler, globName->name, 1);
   } else { // Array Declaration
-    consume(TOKEN_LEFT_BRACE, "Expecting '{' before array initialization.");
-    byteVal(globName->name, globName->length);
-    while (!check(TOKEN_RIGHT_BRACE)) {
-      advance();
+    consume(compiler, TOKEN_LEFT_BRACE, "Expecting '{' before array initialization.");
+    uint32_t address = compiler->globals->currentAddress;
+    byteVal(compiler, globName->name, globName->length);
+    /* Each following value initializes the next element, the last one is kept up to the end */
+    for (int i = 1 ; i < globName->length && match(compiler, TOKEN_COMMA) ; i++) {
+      initialValues(compiler, address, typeWidth(compiler->image, VAL_BYTE), i, globName->length, byteValue(compiler));
     }
-    consume(TOKEN_RIGHT_BRACE, "Expecting '}' after array initialization.");
+    while (!check(compiler, TOKEN_RIGHT_BRACE)) {
+      advance(compiler);
+    }
+    consume(compiler, TOKEN_RIGHT_BRACE, "Expecting '}' after array initialization.");
   }
-  consume(TOKEN_SEMICOLON, "Expecting ';' after variable declaration.");
+  consume(compiler, TOKEN_SEMICOLON, "Expecting ';' after variable declaration.");
+  /* The name is owned by the globals table now */
+  FREE(globName);
 }
 
 
 /* Process int global variable */
-static void globalIntDeclaration() {
+static void globalIntDeclaration(Compiler* compiler) {
   /* Process name and '=' */
   GlobalName* globName = initGlobalName();
-  assignGlobalName(globName);
+  assignGlobalName(compiler, globName);
   /* Test if the identifer is an array definition */
   if (!globName->isArray) { // Simple value
     /* Process Value */
-    intVal(globName->name, 1);
+    intVal(compiler, globName->name, 1);
   } else { // Array Declaration Array access
-    consume(TOKEN_LEFT_BRACE, "Expecting '{' before array initialization.");
-    intVal(globName->name, globName->length);
-    while (!check(TOKEN_RIGHT_BRACE)) {
-      advance();
+    consume(compiler, TOKEN_LEFT_BRACE, "Expecting '{' before array initialization.");
+    uint32_t address = compiler->globals->currentAddress;
+    intVal(compiler, globName->name, globName->length);
+    /* Each following value initializes the next element, the last one is kept up to the end */
+    for (int i = 1 ; i < globName->length && match(compiler, TOKEN_COMMA) ; i++) {
+      initialValues(compiler, address, typeWidth(compiler->image, VAL_INT), i, globName->length, intValue(compiler));
+    }
+    while (!check(compiler, TOKEN_RIGHT_BRACE)) {
+      advance(compiler);
     }
-    consume(TOKEN_RIGHT_BRACE, "Expecting '}' after array initialization.");
+    consume(compiler, TOKEN_RIGHT_BRACE, "Expecting '}' after array initialization.");
   }
-  consume(TOKEN_SEMICOLON, "Expecting ';' after variable declaration.");
+  consume(compiler, TOKEN_SEMICOLON, "Expecting ';' after variable declaration.");
+  /* The name is owned by the globals table now */
+  FREE(globName);
 }
 
 
 /* Process state global variable */
-static void globalStateDeclaration() {
+static void globalStateDeclaration(Compiler* compiler) {
   /* Process state values */
   int stateNumber = 0;
-  consume(TOKEN_LEFT_BRACE,"Expecting '{' before enumeration of states.");
+  consume(compiler, TOKEN_LEFT_BRACE,"Expecting '{' before enumeration of states.");
   do {
-    consume(TOKEN_IDENTIFIER, "Expecting state name.");
-    consume(TOKEN_LEFT_PAREN, "Expecting '(' before state number.");
-    consume(TOKEN_NUMBER, "Expecting number for corresponding state.");
-    consume(TOKEN_RIGHT_PAREN, "Expecting ')' after state number.");
+    consume(compiler, TOKEN_IDENTIFIER, "Expecting state name.");
+    consume(compiler, TOKEN_LEFT_PAREN, "Expecting '(' before state number.");
+    consume(compiler, TOKEN_NUMBER, "Expecting number for corresponding state.");
+    consume(compiler, TOKEN_RIGHT_PAREN, "Expecting ')' after state number.");
     stateNumber++;
-  } while(match(TOKEN_COMMA));
-  if (check(TOKEN_RIGHT_BRACE)) {
-    consume(TOKEN_RIGHT_BRACE,"Expecting '}' after enumeration of states.");
+  } while(match(compiler, TOKEN_COMMA));
+  if (check(compiler, TOKEN_RIGHT_BRACE)) {
+    consume(compiler, TOKEN_RIGHT_BRACE,"Expecting '}' after enumeration of states.");
   } else {
-    error("Missing ',' between states.");
+    error(compiler, "Missing ',' between states.");
   }
   /* Process name and '=' */
   GlobalName* globName = initGlobalName();
-  assignGlobalName(globName);
+  assignGlobalName(compiler, globName);
   /* Process Value */
   Value varValue = NIL_VAL;
-  if (match(TOKEN_NUMBER)) {
-    double currentState = strtod(parser.previous.start, NULL);
+  if (match(compiler, TOKEN_NUMBER)) {
+    double currentState = strtod(compiler->parser.previous.start, NULL);
     if ((currentState < 0) || (currentState > stateNumber-1)) {
-      error("State variable must be initialized with a state between 0 and the number of states.");
+      error(compiler, "State variable must be initialized with a state between 0 and the number of states.");
     }
     varValue = STATE_VAL(currentState, stateNumber);
   } else {
-    error("Wrong type, an int variable must be initialized with a number between -32768 and 32767.");
+    error(compiler, "Wrong type, an int variable must be initialized with a number between -32768 and 32767.");
   }
   /* Add to the globals table */
-  tableSet(compiler->globals, globName->name, varValue, compiler->globals->currentAddress);
+  tableAppend(compiler->globals, globName->name, varValue, compiler->globals->currentAddress);
+  initialValues(compiler, compiler->globals->currentAddress, typeWidth(compiler->image, VAL_STATE), 0, 1, varValue);
   /* Update the current size with the added int */
-  compiler->globals->currentAddress += STATE_SIZE;
-  consume(TOKEN_SEMICOLON, "Expecting ';' after variable declaration.");
+  compiler->globals->currentAddress += typeWidth(compiler->image, VAL_STATE);
+  consume(compiler, TOKEN_SEMICOLON, "Expecting ';' after variable declaration.");
+  /* The name is owned by the globals table now */
+  FREE(globName);
 }
 
 
 /* Declaration of a global variable */
-static void globalDeclaration() {
+static void globalDeclaration(Compiler* compiler) {
   /* Consume type */
-  if (match(TOKEN_BOOL)) {
-    globalBoolDeclaration();
-  } else if (match(TOKEN_BYTE)) {
-    globalByteDeclaration();
-  } else if (match(TOKEN_INT)) {
-    globalIntDeclaration();
-  } else if (match(TOKEN_STATE)) {
-    globalStateDeclaration();
+  if (match(compiler, TOKEN_BOOL)) {
+    globalBoolDeclaration(compiler);
+  } else if (match(compiler, TOKEN_BYTE)) {
+    globalByteDeclaration(compiler);
+  } else if (match(compiler, TOKEN_INT)) {
+    globalIntDeclaration(compiler);
+  } else if (match(compiler, TOKEN_STATE)) {
+    globalStateDeclaration(compiler);
   } else {
-    error("Global declaration must start with a type.");
-  }
-}
-
-
-/* Register utilities
-================== */
-
-/* Shift the pointer up for the top register available for temporary variables */
-static int incrementTopTempRegister() {
-  int topTempNumber = compiler->topTempRegister->number;
-  if (topTempNumber + 1 == REG_NUMBER) {
-    error("Not enough registers to hold temporary variables");
+    error(compiler, "Global declaration must start with a type.");
   }
-  compiler->topTempRegister = &compiler->registers[topTempNumber + 1];
-  if (topTempNumber == compiler->topGlobRegister->number) {
-    /* Emit store if the two stack pointers are pointing to the same register (Temporary has the priority) */
-    compiler->topGlobRegister = &compiler->registers[topTempNumber + 1];
-    writeStoreFromRegister(compiler->topGlobRegister, compiler->chunk);
-    incrementPC();
-  }
-  return topTempNumber;
 }
 
 
-/* Shift the pointer down for the top register available for temporary variables */
-static int decrementTopTempRegister() {
-  int topTempNumber = compiler->topTempRegister->number;
-  emptyRegister(compiler->topTempRegister);
-  compiler->topTempRegister = &compiler->registers[topTempNumber - 1];
-  return topTempNumber;
-}
+/* ==================================
+      MIDDLE END - IR CONSTRUCTION
+=================================== */
 
+/* Operands
+======== */
 
-/* Load a global variable with a given name to the corresponding register */
-static Register* loadGlob(String* name) {
-  /* test if the top temp reg == top glob reg */
-  Register* workingRegister = compiler->topGlobRegister;
-  int topTempNumber  = compiler->topTempRegister->number;
-  int topGlobNumber = compiler->topGlobRegister->number;
-  if (topTempNumber == topGlobNumber) {
-    /* Check if the pointer reached the top */
-    if (topGlobNumber == REG_NUMBER) {
-      error("No more registers available for global allocation.");
-    } else {
-      bool nearEnd = (topGlobNumber + 1 == REG_NUMBER);
-      workingRegister = nearEnd ? &compiler->registers[topGlobNumber] : &compiler->registers[topGlobNumber + 1];
-      // workingRegister = nearEnd ? compiler->registers + sizeof(Register)*(topGlobNumber) : compiler->registers + sizeof(Register)*(topGlobNumber+1);
-      compiler->topGlobRegister = workingRegister;
-      /* Store the old entry in the table */
-      tableSetFromRegister(compiler->globals, workingRegister);
-      /* Emit a store with the variable in the register */
-      writeStoreFromRegister(workingRegister, compiler->chunk);
-      incrementPC();
-      /* Load the new entry in the table */
-      tableGetToRegister(compiler->globals, name, workingRegister);
-      /* Emit a load with the variable in the to use */
-      writeLoadFromRegister(workingRegister, compiler->chunk);
-      incrementPC();
-      /* Shift the pointer head back up */
-      if (!nearEnd) compiler->topGlobRegister = &compiler->registers[topGlobNumber];
-      /* Return the final register */
-    }
-  } else {
-    /* Load the new entry in the table */
-    tableGetToRegister(compiler->globals, name, workingRegister);
-    /* Emit a load with the variable in the to use */
-    writeLoadFromRegister(workingRegister, compiler->chunk);
-    incrementPC();
-    /* Check if the pointer reached the bottom of the stack */
-    if (topGlobNumber != 0) {
-      /* Shift the pointer up */
-      compiler->topGlobRegister = &compiler->registers[topGlobNumber-1];
-    }
+/* Resolve a global variable in the globals table, the operand shares its interned name */
+static Operand globalVariable(Compiler* compiler, Token* name) {
+  int symbol = tableSymbol(compiler->globals, name->start, name->length);
+  if (symbol == -1) {
+    error(compiler, "Global variable should be declared before use.");
+    return globalOperand(irName(compiler->ir, name->start, name->length), -1, 0, VAL_NIL);
   }
-  return workingRegister;
+  Entry* entry = tableEntry(compiler->globals, symbol);
+  /* A global no process writes is read as its initial value */
+  if (entry->constant) return immOperand((int) valueBits(entry->value));
+  return globalOperand(entry->key, symbol, entry->address, entry->value.type);
 }
 
 
-/* Look for the register containing a given variable (NULL otherwise) */
-static Register* getRegFromVar(String* varName) {
-  for (int i = 0 ; i < REG_NUMBER ; i++) {
-    // printf("Looking into register %i!\n", compiler->registers[i].number);
-    if ((compiler->registers[i].varName != NULL) && stringsEqual(varName, compiler->registers[i].varName)) {
-      return &compiler->registers[i];
-    }
-  }
-  return NULL;
+/* Resolve a temporary variable, interned in the process */
+static Operand tempVariable(Compiler* compiler, Token* name) {
+  return namedTemp(compiler->ir, name->start, name->length);
 }
 
-/* Process the index of an array access */
-static Register* processAddress(String* globKey, bool isAssignment) {
-    /* Process Mul Operation */
-    Instruction* offsetMulInstruction = initInstruction();
-    offsetMulInstruction->op_code = OP_MUL;
-    /* Process base address and type */
-    uint32_t baseAddress = 0;
-    Value elementValue = NIL_VAL;
-    tableGet(compiler->globals, globKey, &elementValue, &baseAddress);
-    /* Add the size of the value as the left operand */
-    offsetMulInstruction->imma = elementValue.size * 8;
-    /* Process offset */
-    if (check(TOKEN_NUMBER)) {
-        /* Array access of type:   array[2]  */
-        uint32_t offset = (unsigned int) strtol(parser.current.start, NULL, 0);
-        offsetMulInstruction->immb = offset;
-        offsetMulInstruction->cfg_mask = CFG_II;
-        advance();
-    } else if (check(TOKEN_IDENTIFIER)) {
-        /* Variable */
-        String* varKey = initString();
-        assignString(varKey, parser.current.start, parser.current.length);
-        bool isTempVar = isTemp(varKey->chars);
-        /* Look for the variable in the registers */
-        Register* foundReg = getRegFromVar(varKey);
-        if (foundReg == NULL) { // Value not found
-            if (isTempVar) { // TEMP
-                error("Temporary variable should be defined before use.");
-            } else { // GLOB
-                Register* loadedReg = loadGlob(varKey);
-                offsetMulInstruction->rb = loadedReg->number;
-            }
-        } else {
-            offsetMulInstruction->rb = foundReg->number;
-        }
-        offsetMulInstruction->cfg_mask = CFG_IR;
-        if (isTempVar && !isAssignment) decrementTopTempRegister();
-        advance();
-        freeString(varKey);
-    }
 
-    /* If the array access is an assignment -> special register, else use a temporary */
-    Register* targetRegister = isAssignment ? compiler->addressRegister : compiler->topTempRegister;
-    String* tempAddressRegName = initString();
-    assignString(tempAddressRegName, "t_address", 9);
-    targetRegister->varName = tempAddressRegName;
-    offsetMulInstruction->rd = targetRegister->number;
-    /* Write the actual instruction */
-    uint32_t bitsInstruction = instructionToUint32(offsetMulInstruction);
-    disassembleInstruction(bitsInstruction);
-    writeChunk(compiler->chunk, bitsInstruction);
-    incrementPC();
-    freeInstruction(offsetMulInstruction);
-
-    if (!isAssignment) incrementTopTempRegister();
-    showRegisterState(compiler->registers, compiler->topTempRegister, compiler->topGlobRegister, compiler->addressRegister);
-
-    /* Process ADD operation */
-    Instruction* addAddressInstruction = initInstruction();
-    addAddressInstruction->op_code = OP_ADD;
-    addAddressInstruction->imma = baseAddress;
-    addAddressInstruction->rb = targetRegister->number;
-    addAddressInstruction->rd = targetRegister->number;
-    addAddressInstruction->cfg_mask = CFG_IR;
-    bitsInstruction = instructionToUint32(addAddressInstruction);
-    disassembleInstruction(bitsInstruction);
-    writeChunk(compiler->chunk, bitsInstruction);
-    incrementPC();
-    freeInstruction(addAddressInstruction);
-
-    targetRegister->varValue.type = elementValue.type;
-    return targetRegister;
+/* Process a variable used as an array index or a guard condition */
+static Operand variable(Compiler* compiler, Token* name) {
+  if (isTempToken(name)) return tempVariable(compiler, name);
+  return globalVariable(compiler, name);
 }
 
-/* Assignments
-=========== */
 
-/* Process an immediate value number operand */
-static void immediateValueNumberOperand(bool isLeftSide, Instruction* instruction) {
-  /* Immediate Value */
-  if (isLeftSide) {
-    instruction->imma = (unsigned int) strtol(parser.current.start, NULL, 0); // Left side
-    if (disassembler->verbose) fprintf(disassembler->outstream, "LHS: Setting Immediate value %u!\n", instruction->imma);
-  } else {
-    instruction->immb = (unsigned int) strtol(parser.current.start, NULL, 0); // Right side
-    if (disassembler->verbose) fprintf(disassembler->outstream, "RHS: Setting Immediate value %u!\n", instruction->immb);
+/* Process the index of an array access, the array name has been consumed */
+static void arrayAccess(Compiler* compiler, IrOp* op, Token* arrayName) {
+  /* Process base address and type */
+  Operand array = globalVariable(compiler, arrayName);
+  op->array = array.name;
+  op->arraySymbol = array.symbol;
+  op->base = array.address;
+  if (array.symbol != -1) {
+    Value elementValue = tableEntry(compiler->globals, array.symbol)->value;
+    op->elemType = elementValue.type;
+    op->elemSize = typeWidth(compiler->image, elementValue.type);
   }
-  /* Set corresponding cfg bit to 1 (LHS - second, RHS - first) */
-  instruction->cfg_mask = isLeftSide ? 0b1 << 1 : 0b1;
-  /* Consume the operand */
-  advance();
-}
-
-/* Process an immediate value boolean operand */
-static void immediateValueBooleanOperand(bool isLeftSide, Instruction* instruction) {
-  /* Immediate boolean value */
-  if (isLeftSide) {
-    instruction->imma = (unsigned int) check(TOKEN_TRUE) ? 1 : 0; // Left side
-    if (disassembler->verbose) fprintf(disassembler->outstream, "LHS: Setting Immediate boolean value %u!\n", instruction->imma);
+  /* Consume the opening square bracket */
+  consume(compiler, TOKEN_LEFT_SQBRACKET, "Expecting an array access to be defined as array[index] (left sqbracket missing).");
+  /* Process offset */
+  if (match(compiler, TOKEN_NUMBER)) {
+    /* Array access of type:   array[2]  */
+    op->a = immOperand((int) strtol(compiler->parser.previous.start, NULL, 0));
+  } else if (match(compiler, TOKEN_IDENTIFIER)) {
+    /* Array access of type:   array[i]  */
+    op->a = variable(compiler, &compiler->parser.previous);
   } else {
-    instruction->immb = (unsigned int) check(TOKEN_TRUE) ? 1 : 0; // Right side
-    if (disassembler->verbose) fprintf(disassembler->outstream, "RHS: Setting Immediate boolean value %u!\n", instruction->immb);
+    error(compiler, "Array index should be a number or a variable.");
   }
-  /* Set corresponding cfg bit to 1 (LHS - second, RHS - first) */
-  instruction->cfg_mask = isLeftSide ? 0b1 << 1 : 0b1;
-  /* Consume the operand */
-  advance();
+  /* Consume the closing square bracket */
+  consume(compiler, TOKEN_RIGHT_SQBRACKET, "Expecting an array access to be defined as array[index] (right sqbracket missing).");
 }
 
 
-/* Process a temporary variable operand */
-static void tempVariableOperand(bool isLeftSide, Instruction* instruction) {
-  /* Temporary variable */
-  String* tempKey = initString();
-  assignString(tempKey, parser.current.start, parser.current.length);
-  /* Resolve register */
-  Register* foundReg = getRegFromVar(tempKey);
-  /* Check if the value is found in the registers */
-  if (foundReg == NULL) {
-    /* If not found, raise an error (a rvalue temp should be in a register) */
-    error("Temporary variable on the right side of an assignment should be defined.");
-  } else {
-    /* Set the resolved register to the corresponding register */
-    if (isLeftSide) {
-      instruction->ra = foundReg->number;
-      if (disassembler->verbose) fprintf(disassembler->outstream, "LHS: Setting resolved register %u as a temporary!\n", instruction->ra);
-    } else {
-      instruction->rb = foundReg->number;
-      if (disassembler->verbose) fprintf(disassembler->outstream, "RHS: Setting resolved register %u as a temporary!\n", instruction->rb);
-    }
-  }
-  /* Set corresponding cfg bit to 0 (LHS - second, RHS - first) */
-  instruction->cfg_mask = isLeftSide ? 0b0 << 1 : 0b0;
-  /* Shift the temporary head down */
-  decrementTopTempRegister();
-//  freeString(tempKey);
-  /* Consume the operand */
-  advance();
-}
-
-/* Process a global variable operand */
-static void globVariableOperand(bool isLeftSide, Instruction* instruction, String* globKey) {
-  /* Resolve register */
-  Register* foundReg = getRegFromVar(globKey);
-  /* Check if the value is found in the registers */
-  if (foundReg == NULL) {
-    /* Go to the table and store the value in a register */
-    Register* loadedReg = loadGlob(globKey);
-    if (isLeftSide) {
-      instruction->ra = loadedReg->number;
-      if (disassembler->verbose) fprintf(disassembler->outstream, "LHS: Setting resolved register %u as a global to load!\n", instruction->ra);
-    } else {
-      instruction->rb = loadedReg->number;
-      if (disassembler->verbose) fprintf(disassembler->outstream, "RHS: Setting resolved register %u as a global to load!\n", instruction->rb);
-    }
-    instruction->addr = loadedReg->address;
-  } else {
-    if (isLeftSide) {
-      instruction->ra = foundReg->number;
-      if (disassembler->verbose) fprintf(disassembler->outstream, "LHS: Setting resolved register %u as a global found in the registers!\n", instruction->ra);
-    } else {
-      instruction->rb = foundReg->number;
-      if (disassembler->verbose) fprintf(disassembler->outstream, "RHS: Setting resolved register %u as a global found in the registers!\n", instruction->rb);
-    }
-    instruction->addr = foundReg->address;
-  }
-  /* Set corresponding cfg bit to 0 (LHS - second, RHS - first) */
-  instruction->cfg_mask = isLeftSide ? 0b0 << 1 : 0b0;
-  /* No need to consume the operand as it has already been processed in operand() */
+/* Process a global array access as an operand, the element is loaded in a new temporary */
+static Operand globalArrayAccessOperand(Compiler* compiler, Token* arrayName) {
+  IrOp load = initIrOp(IR_LOAD_ELEM, compiler->parser.previous.line);
+  arrayAccess(compiler, &load, arrayName);
+  load.dst = newTemp(compiler->ir);
+  writeIrOp(compiler->ir, load);
+  return load.dst;
 }
 
-/* Process a global array access as an operand */
-static void globalArrayAccessOperand(bool isLeftSide, Instruction* instruction, String* globKey) {
-  /* Consume the opening square bracket */
-  consume(TOKEN_LEFT_SQBRACKET, "Expecting usage of an array access as operand to be defined as array[index] (left sqbracket missing).");
-  /* Process the index => Emit a mul instruction between offset and type of data */
-  /* Process the base address and add the index to it */
-  Register* addressRegister = processAddress(globKey, false);
-  Instruction* loadValueInstruction = initInstruction();
-  /* Setup register */
-  Register* loadedValueRegister = addressRegister; // Stay in the same register to load the value
-  String* tempValueRegName = initString();
-  assignString(tempValueRegName, "t_larr", 6);
-  loadedValueRegister->varName = tempValueRegName;
-  /* Setup load instruction */
-  loadValueInstruction->op_code = OP_LOAD;
-  loadValueInstruction->rd = loadedValueRegister->number;
-  loadValueInstruction->ra = addressRegister->number;
-  loadValueInstruction->cfg_mask = LOAD_RAA;
-  loadValueInstruction->type = typeCfg(addressRegister->varValue.type);
-  incrementTopTempRegister();
-  /* Write the load instruction */
-  uint32_t bitsInstruction = instructionToUint32(loadValueInstruction);
-  disassembleInstruction(bitsInstruction);
-  writeChunk(compiler->chunk, bitsInstruction);
-  incrementPC();
-  freeInstruction(loadValueInstruction);
-  /* Consume the closing square bracket */
-  consume(TOKEN_RIGHT_SQBRACKET, "Expecting usage of an array access as operand to be defined as array[index] (right sqbracket missing).");
-
-  /* Process expression */
-  /* Set the resolved register to the corresponding register */
-  if (isLeftSide) {
-    instruction->ra = loadedValueRegister->number;
-    if (disassembler->verbose) fprintf(disassembler->outstream, "LHS: Setting resolved register %u as an array access!\n", instruction->ra);
-  } else {
-    instruction->rb = loadedValueRegister->number;
-    if (disassembler->verbose) fprintf(disassembler->outstream, "RHS: Setting resolved register %u as an array access!\n", instruction->rb);
-  }
-  /* Set corresponding cfg bit to 0 (LHS - second, RHS - first) */
-  instruction->cfg_mask = isLeftSide ? 0b0 << 1 : 0b0;
-
-  /* Shift the temporary head down */
-  decrementTopTempRegister(); // First one for temp
-  decrementTopTempRegister();
-}
 
 /* Process an operand */
-static void operand(bool isLeftSide, Instruction* instruction) {
-  if(check(TOKEN_NUMBER)) {
+static Operand operand(Compiler* compiler) {
+  if (match(compiler, TOKEN_NUMBER)) {
     /* Immediate number value */
-    immediateValueNumberOperand(isLeftSide, instruction);
-  } else if (check(TOKEN_TRUE) || check(TOKEN_FALSE)) {
+    return immOperand((int) strtol(compiler->parser.previous.start, NULL, 0));
+  } else if (match(compiler, TOKEN_TRUE)) {
     /* Immediate boolean value */
-    immediateValueBooleanOperand(isLeftSide, instruction);
-  } else if(check(TOKEN_IDENTIFIER)) {
+    return immOperand(1);
+  } else if (match(compiler, TOKEN_FALSE)) {
+    return immOperand(0);
+  } else if (match(compiler, TOKEN_IDENTIFIER)) {
     /* Variable */
-    if (isTempToken(&parser.current)) {
-      /* Temporary variable */
-      tempVariableOperand(isLeftSide, instruction);
-    } else {
-      consume(TOKEN_IDENTIFIER, "Variable assignment should have an identifier");
-      /* Store the name of the variable in a string */
-      String* globKey = initString();
-      assignString(globKey, parser.previous.start, parser.previous.length);
-      /* Check if it is an array access or a simple assignment */
-      if (check(TOKEN_LEFT_SQBRACKET)) {
-        /* Array access */
-        globalArrayAccessOperand(isLeftSide, instruction, globKey);
-      } else {
-        /* Simple assignment */
-        globVariableOperand(isLeftSide, instruction, globKey);
-      }
-//      freeString(globKey);
-    }
-  } else {
-    /* Not a variable or an immediate value */
-    error("An assignment needs the rvalue to be either a variable or immediate value.");
+    Token name = compiler->parser.previous;
+    if (isTempToken(&name)) return tempVariable(compiler, &name);
+    /* Check if it is an array access or a simple variable */
+    if (check(compiler, TOKEN_LEFT_SQBRACKET)) return globalArrayAccessOperand(compiler, &name);
+    return globalVariable(compiler, &name);
   }
-}
-
-
-/* Process the left hand side of an expression */
-static void leftHandSide(Instruction* instruction) {
-  operand(true, instruction);
-}
-
-
-/* Process the right hand side of an expression */
-static void rightHandSide(Instruction* instruction) {
-  operand(false, instruction);
+  /* Not a variable or an immediate value */
+  error(compiler, "An assignment needs the rvalue to be either a variable or immediate value.");
+  return noOperand();
 }
 
 
 /* Process the binary operator and deduce the corresponding opcode */
-bool operator(Instruction* instruction) {
+bool operator(Compiler* compiler, IrOp* op) {
   /* Consume operator */
-  if (isBinOp(&parser.current)) {
-    BinaryOperatorConfig binopCfg = binopTable[parser.current.type];
-    instruction->op_code = binopCfg.op_code;
+  if (isBinOp(&compiler->parser.current)) {
+    BinaryOperatorConfig binopCfg = binopTable[compiler->parser.current.type];
+    op->op_code = binopCfg.op_code;
     /* Consume operator */
-    advance();
+    advance(compiler);
     return binopCfg.isNegated;
   } else {
-    error("Expected binary operator.");
+    error(compiler, "Expected binary operator.");
   }
   return false;
 }
 
 
-/* Process an expression */
-static bool expression(Instruction* instruction) {
+/* Process an expression, the result of the operation is left to the caller */
+static void expression(Compiler* compiler, IrOp* op) {
   /* If find token NOT setup an a bool flag */
-  bool NOTinExpression = false;
-  if (check(TOKEN_NOT)) {
-      advance();
-      NOTinExpression = true;
-  }
+  bool NOTinExpression = match(compiler, TOKEN_NOT);
 
   /* Consume left hand side of expression */
-  leftHandSide(instruction);
+  op->a = operand(compiler);
 
-  if (!(check(TOKEN_SEMICOLON) || check(TOKEN_COMMA))) {
+  if (!(check(compiler, TOKEN_SEMICOLON) || check(compiler, TOKEN_COMMA))) {
+    op->type = IR_BINARY;
     /* Consume operator */
-    bool isNegated = operator(instruction);
+    bool isNegated = operator(compiler, op);
     /* Consume right hand side of expression */
-    rightHandSide(instruction);
-    return isNegated;
+    op->b = operand(compiler);
+    /* A negated comparison under a NOT cancels out */
+    op->negated = NOTinExpression != isNegated;
   } else {
-    instruction->op_code  = OP_LOAD;
-    /* Convert the binary bitmask to the load version */
-    if ((instruction->cfg_mask == CFG_RR) || (instruction->cfg_mask == CFG_RI)) {
-      /* REG as the left-hand side */
-      instruction->cfg_mask = LOAD_REG;
-    } else {
-      instruction->cfg_mask = LOAD_IMM;
-    }
+    op->type = IR_ASSIGN;
+    op->negated = NOTinExpression;
   }
-  return NOTinExpression;
 }
 
+/* Assignments
+=========== */
+
 /* Assign a value to an array element */
-static void globalArrayAccess(String* globKey) {
-  /* Consume the opening square bracket */
-  consume(TOKEN_LEFT_SQBRACKET, "Expecting assignment to an array element to be defined as array[index] (left sqbracket missing).");
-  /* Process the index => Emit a mul instruction between offset and type of data */
-  /* Process the base address and add the index to it */
-  Register* addressRegister = processAddress(globKey, true);
-  Instruction* loadValueInstruction = initInstruction();
-  /* Setup register */
-  unsigned int typeCode = typeCfg(addressRegister->varValue.type);
-  Register* loadedValueRegister = compiler->topTempRegister;
-  String* tempValueRegName = initString();
-  assignString(tempValueRegName, "t_larr", 6);
-  loadedValueRegister->varName = tempValueRegName;
-  loadValueInstruction->op_code = OP_LOAD;
-  loadValueInstruction->rd = loadedValueRegister->number;
-  loadValueInstruction->ra = addressRegister->number;
-  loadValueInstruction->cfg_mask = LOAD_RAA;
-  loadValueInstruction->type = typeCode;
-  incrementTopTempRegister();
-  /* Write the load instruction */
-  uint32_t bitsInstruction = instructionToUint32(loadValueInstruction);
-  disassembleInstruction(bitsInstruction);
-  writeChunk(compiler->chunk, bitsInstruction);
-  incrementPC();
-  freeInstruction(loadValueInstruction);
-  showRegisterState(compiler->registers, compiler->topTempRegister, compiler->topGlobRegister, compiler->addressRegister);
-  /* Consume the closing square bracket */
-  consume(TOKEN_RIGHT_SQBRACKET, "Expecting assignment to an array element to be defined as array[index] (right sqbracket missing).");
-  consume(TOKEN_EQUAL, "Expecting '=' in assignment.");
+static void globalArrayAccess(Compiler* compiler, Token* arrayName) {
+  IrOp store = initIrOp(IR_STORE_ELEM, compiler->parser.previous.line);
+  arrayAccess(compiler, &store, arrayName);
+  consume(compiler, TOKEN_EQUAL, "Expecting '=' in assignment.");
   /* Process expression */
-  Instruction* expressionInstruction = initInstruction();
-  bool negated = expression(expressionInstruction);
-
-  /* Determine rd */
-  expressionInstruction->rd = loadedValueRegister->number;
-  bitsInstruction = instructionToUint32(expressionInstruction);
-  disassembleInstruction(bitsInstruction);
-  writeChunk(compiler->chunk, bitsInstruction);
-  incrementPC();
-
-  /* Write not instruction */
-  if (negated) {
-    Instruction* notInstr = initInstruction();
-    uint32_t bitsNotInstruction = notInstruction(notInstr, expressionInstruction->rd);
-    disassembleInstruction(bitsNotInstruction);
-    writeChunk(compiler->chunk,bitsNotInstruction);
-    incrementPC();
-    freeInstruction(notInstr);
+  IrOp value = initIrOp(IR_ASSIGN, compiler->parser.previous.line);
+  expression(compiler, &value);
+  if (value.type == IR_ASSIGN && !value.negated) {
+    /* Plain value, stored directly */
+    store.b = value.a;
+  } else {
+    /* The value is computed in a temporary then stored */
+    value.dst = newTemp(compiler->ir);
+    writeIrOp(compiler->ir, value);
+    store.b = value.dst;
   }
-  /* Free initial instruction */
-  freeInstruction(expressionInstruction);
-
-  /* Write Store for the array element */
-  Instruction* storeInstruction = initInstruction();
-  storeInstruction->op_code = OP_STORE;
-  storeInstruction->rd = loadedValueRegister->number;
-  storeInstruction->ra = addressRegister->number;
-  storeInstruction->cfg_mask = STORE_RAA; // STOREs_REG_AS_ADDR to define
-  storeInstruction->type = typeCode;
-  bitsInstruction = instructionToUint32(storeInstruction);
-  disassembleInstruction(bitsInstruction);
-  writeChunk(compiler->chunk, bitsInstruction);
-  incrementPC();
-  freeInstruction(storeInstruction);
-
-  decrementTopTempRegister();
+  writeIrOp(compiler->ir, store);
 }
 
+
 /* Assign a value to a global variable */
-static void globalAssignment(String* globKey) {
+static void globalAssignment(Compiler* compiler, Token* globKey) {
+  IrOp op = initIrOp(IR_ASSIGN, compiler->parser.previous.line);
+  op.dst = globalVariable(compiler, globKey);
   /* Consume the equal token */
-  consume(TOKEN_EQUAL, "Expecting '=' in assignment.");
+  consume(compiler, TOKEN_EQUAL, "Expecting '=' in assignment.");
   /* Process expression */
-  Instruction* instruction = initInstruction();
-  bool negated = expression(instruction);
-  /* Determine rd */
-  Register* foundReg = getRegFromVar(globKey);
-  /* If the register is NULL -> Store the value into a new one */
-  if (foundReg == NULL) {
-    /* Go to the table and store the value in a register */
-    Register* loadedReg = loadGlob(globKey);
-    instruction->rd = loadedReg->number;
-  } else {
-    /* Set the resolved register to rb */
-    instruction->rd = foundReg->number;
-  }
-  /* Write instruction */
-  uint32_t bitsInstruction = instructionToUint32(instruction);
-  disassembleInstruction(bitsInstruction);
-  writeChunk(compiler->chunk, bitsInstruction);
-  incrementPC();
-
-  /* Write not instruction */
-  if (negated) {
-    Instruction* notInstr = initInstruction();
-    uint32_t bitsNotInstruction = notInstruction(notInstr, instruction->rd);
-    disassembleInstruction(bitsNotInstruction);
-    writeChunk(compiler->chunk,bitsNotInstruction);
-    incrementPC();
-    freeInstruction(notInstr);
-  }
-
-  /* Free initial instruction */
-  freeInstruction(instruction);
+  expression(compiler, &op);
+  writeIrOp(compiler->ir, op);
 }
 
 
-/* Assign a value to a given temporary variable and store it in a register */
-static void tempAssignment() {
-  /* Consume temp token, probably need to use it to access the hash table */
-  consume(TOKEN_TEMP, "Temporary variable assignment should begin with 'temp'.");
+/* Assign a value to a given temporary variable */
+static void tempAssignment(Compiler* compiler) {
+  /* Consume temp token */
+  consume(compiler, TOKEN_TEMP, "Temporary variable assignment should begin with 'temp'.");
   /* Consume the type */
-  if (check(TOKEN_BOOL) || check(TOKEN_BYTE) || check(TOKEN_INT)) {
-    advance();
+  if (check(compiler, TOKEN_BOOL) || check(compiler, TOKEN_BYTE) || check(compiler, TOKEN_INT)) {
+    advance(compiler);
   } else {
-    error("Temporary variable assignment should have a type.");
+    error(compiler, "Temporary variable assignment should have a type.");
   }
-  /* Consume identifier, probably need to use it to access the hash table */
-  consume(TOKEN_IDENTIFIER, "Variable assignment should have an identifier");
-  /* Store the name of the variable in a string */
-  String* tempKey = initString();
-  assignString(tempKey, parser.previous.start, parser.previous.length);
+  /* Consume identifier */
+  consume(compiler, TOKEN_IDENTIFIER, "Variable assignment should have an identifier");
+  IrOp op = initIrOp(IR_ASSIGN, compiler->parser.previous.line);
+  op.dst = tempVariable(compiler, &compiler->parser.previous);
   /* Consume the equal token */
-  consume(TOKEN_EQUAL, "Expecting '=' in assignment.");
+  consume(compiler, TOKEN_EQUAL, "Expecting '=' in assignment.");
   /* Process expression */
-  Instruction* instruction = initInstruction();
-  bool negated = expression(instruction);
-  /* Determine rd and shift pointer up */
-  compiler->topTempRegister->varName = tempKey;
-  instruction->rd = incrementTopTempRegister();
-  /* Write instruction */
-  uint32_t bitsInstruction = instructionToUint32(instruction);
-  disassembleInstruction(bitsInstruction);
-  writeChunk(compiler->chunk, bitsInstruction);
-  incrementPC();
-  /* Write not instruction */
-  if (negated) {
-    Instruction* notInstr = initInstruction();
-    uint32_t bitsNotInstruction = notInstruction(notInstr, instruction->rd);
-    disassembleInstruction(bitsNotInstruction);
-    writeChunk(compiler->chunk,bitsNotInstruction);
-    incrementPC();
-    freeInstruction(notInstr);
-  }
-
-  /* Free initial instruction */
-  freeInstruction(instruction);
+  expression(compiler, &op);
+  writeIrOp(compiler->ir, op);
 }
 
 
 /* Check variable name to determine if it is a temporary variable or not */
-static void assignment() {
-  if (check(TOKEN_TEMP)) {
-    tempAssignment();
-  } else if (check(TOKEN_IDENTIFIER)) {
-    consume(TOKEN_IDENTIFIER, "Variable assignment should have an identifier");
-    /* Store the name of the variable in a string */
-    String* globKey = initString();
-    assignString(globKey, parser.previous.start, parser.previous.length);
+static void assignment(Compiler* compiler) {
+  if (check(compiler, TOKEN_TEMP)) {
+    tempAssignment(compiler);
+  } else if (match(compiler, TOKEN_IDENTIFIER)) {
+    /* Keep the token of the variable, it is resolved by the assignment */
+    Token globKey = compiler->parser.previous;
     /* Check if it is an array access or a simple assignment */
-    if (check(TOKEN_LEFT_SQBRACKET)) {
+    if (check(compiler, TOKEN_LEFT_SQBRACKET)) {
       /* Array access */
-      globalArrayAccess(globKey);
+      globalArrayAccess(compiler, &globKey);
     } else {
       /* Simple assignment */
-      globalAssignment(globKey);
+      globalAssignment(compiler, &globKey);
     }
-    /* Free the global key string */
-//    freeString(globKey);
   } else {
-    error("An assignment should begin with either an identifier (global) or 'temp' (temporary).");
+    error(compiler, "An assignment should begin with either an identifier (global) or 'temp' (temporary).");
   }
 
-  if (parser.panicMode) synchronize();
-  showRegisterState(compiler->registers, compiler->topTempRegister, compiler->topGlobRegister, compiler->addressRegister);
-//  showTableState(compiler->globals);
+  if (compiler->parser.panicMode) synchronize(compiler);
 }
 
 
@@ -1032,146 +759,458 @@ static void assignment() {
 ======= */
 
 /* Process guardblock (sequence of assignments) */
-static void guardBlock() {
-  consume(TOKEN_GUARD_BLOCK, "Guardblock should begin with 'guardblock' identifier.");
-  assignment();
-  while(check(TOKEN_COMMA)) {
-    consume(TOKEN_COMMA, "Separate assignments with ','.");
-    assignment();
+static void guardBlock(Compiler* compiler) {
+  consume(compiler, TOKEN_GUARD_BLOCK, "Guardblock should begin with 'guardblock' identifier.");
+  assignment(compiler);
+  while(check(compiler, TOKEN_COMMA)) {
+    consume(compiler, TOKEN_COMMA, "Separate assignments with ','.");
+    assignment(compiler);
   }
-  consume(TOKEN_SEMICOLON, "End list of assignments in guardblock with ';'.");
+  consume(compiler, TOKEN_SEMICOLON, "End list of assignments in guardblock with ';'.");
 }
 
-/* Process guardblock (sequnce of assignments) */
-static int guardCondition() {
-  consume(TOKEN_GUARD_COND, "Guardcondition should begin with 'guardcondition' identifier.");
+/* Process guardcondition (variable deciding if the effect is applied) */
+static void guardCondition(Compiler* compiler) {
+  consume(compiler, TOKEN_GUARD_COND, "Guardcondition should begin with 'guardcondition' identifier.");
   /* Process identifier */
-  consume(TOKEN_IDENTIFIER, "Guardcondition should hold a variable to be tested.");
-  /* Store the name of the variable in a string */
-  String* tempTest = initString();
-  assignString(tempTest, parser.previous.start, parser.previous.length);
-  /* Resolve register */
-  Register* foundReg = getRegFromVar(tempTest);
-  /* Check if the value is found in the registers */
-  if (foundReg == NULL) {
-    /* If not found, raise an error (a rvalue temp should be in a register) */
-    error("Temporary variable on the right side of an assignment should be defined.");
-  } else {
-    /* Emit a JMP with a placeholder */
-    Instruction* jmpInstr = initInstruction();
-    uint32_t bitJmpInstr = jumpInstruction(jmpInstr, foundReg->number, 0x000000);
-    writeChunk(compiler->chunk, bitJmpInstr);
-    incrementPC();
-    freeInstruction(jmpInstr);
-  }
-  /* Free the test string */
-  freeString(tempTest);
-
-  decrementTopTempRegister();
-  consume(TOKEN_SEMICOLON, "Guardcondition should end with ';'.");
-  return compiler->chunk->count;
+  consume(compiler, TOKEN_IDENTIFIER, "Guardcondition should hold a variable to be tested.");
+  IrOp guard = initIrOp(IR_GUARD, compiler->parser.previous.line);
+  guard.a = variable(compiler, &compiler->parser.previous);
+  compiler->ir->guardIndex = writeIrOp(compiler->ir, guard);
+  consume(compiler, TOKEN_SEMICOLON, "Guardcondition should end with ';'.");
 }
 
 /* Process effect (sequnce of assignments) */
-static void effect() {
-  consume(TOKEN_EFFECT, "Effect declaration should start with 'effect' identifier.");
-  assignment();
-  while(check(TOKEN_COMMA)) {
-    consume(TOKEN_COMMA, "Separate assignments with ','.");
-    assignment();
-  }
-  consume(TOKEN_SEMICOLON, "End list of assignments in guardblock with ';'.");
-
-  /* Emit the different stores for the stored global variables */
-  for (int i = compiler->topGlobRegister->number + 1; i < REG_NUMBER ; i++) {
-    writeStoreFromRegister(&compiler->registers[i], compiler->chunk);
-    incrementPC();
+static void effect(Compiler* compiler) {
+  consume(compiler, TOKEN_EFFECT, "Effect declaration should start with 'effect' identifier.");
+  assignment(compiler);
+  while(check(compiler, TOKEN_COMMA)) {
+    consume(compiler, TOKEN_COMMA, "Separate assignments with ','.");
+    assignment(compiler);
   }
-}
-
-/* Process end of a process */
-static void endProcess(int jmpSrc) {
-  /* Emit a reset jump instruction */
-  Instruction* endGA = initInstruction();
-  uint32_t bitEndGA = endGAInstruction(endGA);
-  writeChunk(compiler->chunk, bitEndGA);
-  incrementPC();
-  freeInstruction(endGA);
-  uint32_t oldInstr = compiler->chunk->instructions[jmpSrc-1];
-  /* Patch the jump from guardcondition */
-  if (disassembler->verbose) fprintf(disassembler->outstream, "Backpatching Jump from: %d\n", jmpSrc);
-  compiler->chunk->instructions[jmpSrc-1] = (oldInstr & 0xFF000000) | (compiler->pc);
-  /* Reset top glob and temp registers */
-  compiler->topTempRegister = &compiler->registers[0];
-  compiler->topGlobRegister = &compiler->registers[REG_NUMBER-1];
+  consume(compiler, TOKEN_SEMICOLON, "End list of assignments in guardblock with ';'.");
 }
 
 /* Process declaration */
-static void process() {
+static void process(Compiler* compiler) {
+  /* The temporaries are numbered after the globals */
+  compiler->ir->firstTemp = compiler->globals->symbolCount;
   /* Consume process token */
-  consume(TOKEN_PROCESS, "Expecting 'process' to begin a process declaration.");
+  consume(compiler, TOKEN_PROCESS, "Expecting 'process' to begin a process declaration.");
   /* Consume process name */
-  consume(TOKEN_IDENTIFIER, "Process should be given a name.");
+  consume(compiler, TOKEN_IDENTIFIER, "Process should be given a name.");
   /* Go through guardblock */
-  guardBlock();
-  /* Go through guardcondition, store the index of the jmp instruction */
-  int jmpSrc = guardCondition();
+  guardBlock(compiler);
+  /* Go through guardcondition */
+  guardCondition(compiler);
   /* Go through effect */
-  effect();
-  /* Finalization operations */
-  endProcess(jmpSrc);
+  effect(compiler);
+  /* Optimize then lower the process to instructions */
+  if (!compiler->parser.hadError) {
+    optimizeProcess(compiler->ir);
+    if (compiler->disassembler->verbose) fprintIrProcess(compiler->disassembler->outstream, compiler->ir);
+    if (!lowerProcess(compiler, compiler->ir)) compiler->parser.hadError = true;
+  }
+}
+
+
+/* Hand the chunk of the process over to the partition (appended if index is negative), then release its IR and arena in one go */
+static void endProcess(Compiler* compiler, Partition* partition, int index) {
+  if (index < 0) {
+    addProcess(partition, compiler->chunk, compiler->ir);
+  } else {
+    setProcess(partition, index, compiler->chunk, compiler->ir);
+  }
+  resetIrProcess(compiler->ir);
+}
+
+
+/* ==================================
+        PARALLEL COMPILATION
+=================================== */
+
+/* Processes shared by the workers, handed over in source order */
+typedef struct {
+  Compiler* parent;      /* Compiler holding the globals table */
+  char* source;          /* Source being compiled */
+  ProcessOffset* starts; /* Start of each process */
+  int count;             /* Number of processes */
+  int next;              /* Next process to compile */
+  Partition* partition;  /* Compiled processes, one slot per process */
+  bool hadError;         /* A worker encountered an error */
+  pthread_mutex_t lock;  /* Protects next and hadError */
+} WorkQueue;
+
+/* Compile the process at a given start, as the sequential loop would */
+static void compileProcessAt(Compiler* worker, char* source, ProcessOffset* start) {
+  if (worker->tokens != NULL) {
+    worker->next = start->token;
+  } else {
+    initScannerAt(&worker->scanner, source, start);
+  }
+  worker->parser.current = nextToken(worker);
+  worker->parser.panicMode = false;
+  worker->chunk = initChunk();
+  worker->pc = 0;
+  process(worker);
+  /* Anything else than the next process is reported by the sequential loop */
+  if (!check(worker, TOKEN_PROCESS) && !check(worker, TOKEN_EOF)) {
+    errorAtCurrent(worker, "Expecting 'process' to begin a process declaration.");
+  }
+}
+
+/* Worker thread, takes the next process until there is none left */
+static void* compileWorker(void* arg) {
+  WorkQueue* queue = (WorkQueue*)arg;
+  Compiler* worker = initWorker(queue->parent);
+  freeChunk(worker->chunk);
+  for (;;) {
+    pthread_mutex_lock(&queue->lock);
+    int index = queue->next++;
+    pthread_mutex_unlock(&queue->lock);
+    if (index >= queue->count) break;
+    compileProcessAt(worker, queue->source, &queue->starts[index]);
+    endProcess(worker, queue->partition, index);
+  }
+  pthread_mutex_lock(&queue->lock);
+  queue->hadError |= worker->parser.hadError;
+  pthread_mutex_unlock(&queue->lock);
+  worker->chunk = NULL;
+  freeState(worker);
+  return NULL;
+}
+
+/* Compile the processes on several threads, each process is stored at its source index
+   so the result does not depend on the scheduling */
+static void compileParallel(Compiler* compiler, char* source, ProcessIndex* processes, Partition* partition, int jobs) {
+  WorkQueue queue;
+  queue.parent = compiler;
+  queue.source = source;
+  queue.starts = processes->offsets;
+  queue.count = processes->count;
+  queue.next = 0;
+  queue.partition = partition;
+  queue.hadError = false;
+  pthread_mutex_init(&queue.lock, NULL);
+  reserveProcesses(partition, queue.count);
+  if (jobs > queue.count) jobs = queue.count;
+  pthread_t* threads = ALLOCATE_ARRAY(pthread_t, jobs > 0 ? jobs : 1);
+  int started = 0;
+  for (int i = 0 ; i < jobs ; i++) {
+    if (pthread_create(&threads[started], NULL, compileWorker, &queue) == 0) started++;
+  }
+  /* Without any thread the processes are compiled here */
+  if (started == 0) compileWorker(&queue);
+  for (int i = 0 ; i < started ; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  FREE(threads);
+  pthread_mutex_destroy(&queue.lock);
+  if (queue.hadError) compiler->parser.hadError = true;
 }
 
 
 /* ==================================
           COMPILE ROUTINE
 =================================== */
-bool compile(char* source, int nbTargets, int nbGA, char* binName) {
-  /* Initialize scanner */
-  initScanner(source);
-  advance(); // Move to the first token
-  /* Initialize parser error handling */
-  parser.hadError  = false;
-  parser.panicMode = false;
-  /* Compile globals */
-  while(!check(TOKEN_PROCESS) && !match(TOKEN_EOF)) {
-    globalDeclaration();
-    if (parser.hadError) return parser.hadError;
+
+/* Write the initial state vector next to the binaries, false if it could not be written */
+static bool writeInitFile(StateImage* image, CompileOptions* options) {
+  char initName[256];
+  snprintf(initName, sizeof(initName), "%s.init", options->binName);
+  if (!writeImage(image, initName)) {
+    fprintf(stderr, "Could not write file \"%s\".\n", initName);
+    return false;
   }
-  /* Show the table state if the verbose option is checked */
-  showTableState(compiler->globals);
-
-  /* Distribute the number of GA per target */
-  int gaPerTarget = nbGA / nbTargets;
-  int additionalGA = nbGA % nbTargets;
-  /* Go through processes */
-  int targetCount = 0;
-  int instrCount = 0;
-  while(!match(TOKEN_EOF)) {
-      int count = 0;
-      while (count < gaPerTarget) {
-          process();
-          count++;
-      }
-      if (targetCount < additionalGA) {
-          process();
-          count++;
-      }
-      disassembleChunk(compiler->chunk);
+  /* A packed layout can not be decoded without its widths, the image itself stays as is for the host */
+  if (!packedWidths(image)) return true;
+  char widthsName[256];
+  snprintf(widthsName, sizeof(widthsName), "%s.widths", options->binName);
+  if (writeWidths(image, widthsName)) return true;
+  fprintf(stderr, "Could not write file \"%s\".\n", widthsName);
+  return false;
+}
+
+
+/* Distribute the processes over the targets and write a binary per target and the initial state
+   vector (or their sections in a container), false if one of them could not be written */
+static bool writeTargets(Disassembler* disassembler, Partition* partition, CompileOptions* options, StateImage* image,
+                         uint32_t* instrCount) {
+  int nbTargets = options->nbTargets;
+  bool written = true;
+  partitionProcesses(partition, nbTargets, options->partition);
+  Container* container = NULL;
+  char containerName[256];
+  if (options->format == OUTPUT_CONTAINER) {
+    snprintf(containerName, sizeof(containerName), "%s.sdvb", options->binName);
+    int targetCount = nbTargets > 0 ? nbTargets : 0;
+    container = openContainer(containerName, targetCount, image->size, image->widths, targetCount + 1);
+    if (container == NULL) {
+      fprintf(stderr, "Could not open file \"%s\".\n", containerName);
+      written = false;
+    } else {
+      addSection(container, SECTION_INIT, 0, image->bytes, imageLength(image));
+    }
+  } else {
+    written = writeInitFile(image, options);
+  }
+  for (int target = 0 ; target < nbTargets ; target++) {
+    Chunk* chunk = targetChunk(partition, target);
+    /* Every target has a section in a container, empty if it has no process */
+    if (container != NULL) addSection(container, SECTION_CODE, target, chunk->instructions, chunk->count * sizeof(uint32_t));
+    /* Fewer processes than targets leave the last targets empty */
+    if (chunk->count == 0) {
+      freeChunk(chunk);
+      continue;
+    }
+    disassembleChunk(disassembler, chunk);
+    if (options->format == OUTPUT_RAW) {
       /* Write the output to the binary */
       char outFileName[100];
-      snprintf(outFileName, 100, "%s.%d", binName, targetCount);
+      snprintf(outFileName, 100, "%s.%d", options->binName, target);
       FILE *writeOutstream = fopen(outFileName, "w");
-      fwrite(compiler->chunk->instructions, sizeof(uint32_t), compiler->chunk->count, writeOutstream);
-      instrCount += compiler->chunk->count;
-      /* Reinitialize the compiler */
+      if (writeOutstream == NULL) {
+        fprintf(stderr, "Could not open file \"%s\".\n", outFileName);
+        written = false;
+      } else {
+        fwrite(chunk->instructions, sizeof(uint32_t), chunk->count, writeOutstream);
+        fclose(writeOutstream);
+      }
+    }
+    *instrCount += chunk->count;
+    freeChunk(chunk);
+  }
+  if (container != NULL && !closeContainer(container)) {
+    fprintf(stderr, "Could not write file \"%s\".\n", containerName);
+    written = false;
+  }
+  reportPartition(disassembler->outstream, partition, nbTargets);
+  return written;
+}
+
+
+/* Walk the process bodies from the current token without moving the parser (the pages of a streamed
+   source are given back as the walk goes). The globals are ordered by their first access if an order is
+   given, and the ones a process writes or indexes are flagged in kept if given. */
+static void scanAccesses(Compiler* compiler, Source* source, AccessOrder* order, bool* kept) {
+  Scanner scanner = compiler->scanner;
+  int next = compiler->next;
+  TokenType previous = TOKEN_EOF;
+  int previousSymbol = -1;
+  int target = -1;
+  for (Token token = compiler->parser.current ; token.type != TOKEN_EOF ;
+       token = compiler->tokens != NULL ? tokenAt(compiler->tokens, next++) : scanToken(&scanner)) {
+    if (token.type == TOKEN_PROCESS && source != NULL) releaseSource(source, token.start - source->chars);
+    int symbol = -1;
+    if (token.type == TOKEN_IDENTIFIER && !isTempToken(&token)) {
+      symbol = tableSymbol(compiler->globals, token.start, token.length);
+    }
+    if (order != NULL) accessGlobal(order, symbol);
+    if (kept != NULL) {
+      /* An assignment follows 'guardblock', 'effect' or a comma, the global it begins with is written at its '=' */
+      if (previous == TOKEN_GUARD_BLOCK || previous == TOKEN_EFFECT || previous == TOKEN_COMMA) target = symbol;
+      if (token.type == TOKEN_EQUAL) {
+        if (target != -1) kept[target] = true;
+        target = -1;
+      }
+      /* An indexed global stays in memory, the index may be a variable */
+      if (token.type == TOKEN_LEFT_SQBRACKET && previousSymbol != -1) kept[previousSymbol] = true;
+    }
+    previous = token.type;
+    previousSymbol = symbol;
+  }
+}
+
+
+/* Index the declared globals, the names of the declarations given again are not referred to anymore */
+static void freezeGlobals(Table* globals) {
+  String** keys = ALLOCATE_ARRAY(String*, globals->symbolCount > 0 ? globals->symbolCount : 1);
+  for (int i = 0 ; i < globals->symbolCount ; i++) keys[i] = globals->symbols[i].key;
+  tableFreeze(globals);
+  for (int i = 0 ; i < globals->symbolCount ; i++) {
+    if (globals->symbols[i].key == NULL) freeString(keys[i]);
+  }
+  FREE(keys);
+}
+
+
+/* Compile the global declarations from the first token then lay them out, true if an error was
+   encountered (the source is given when streamed, NULL otherwise) */
+static bool globalDeclarations(Compiler* compiler, CompileOptions* options, Source* source) {
+  /* Initialize parser error handling */
+  compiler->parser.hadError  = false;
+  compiler->parser.panicMode = false;
+  /* Compile globals */
+  while(!check(compiler, TOKEN_PROCESS) && !match(compiler, TOKEN_EOF)) {
+    globalDeclaration(compiler);
+    if (compiler->parser.hadError) return true;
+  }
+  /* No more globals, the table is only read from here (by the workers too) */
+  freezeGlobals(compiler->globals);
+  /* The image covers the whole state vector */
+  sizeImage(compiler->image, compiler->globals->currentAddress);
+  /* The layout is known before the processes are compiled, their accesses are gathered beforehand */
+  uint32_t unpacked = imageLength(compiler->image);
+  if (options->pack || options->reorder || options->inlineConstants) {
+    AccessOrder* order = options->reorder ? initAccessOrder(compiler->globals) : NULL;
+    bool* kept = NULL;
+    if (options->inlineConstants) {
+      kept = ALLOCATE_ARRAY(bool, compiler->globals->symbolCount > 0 ? compiler->globals->symbolCount : 1);
+      for (int i = 0 ; i < compiler->globals->symbolCount ; i++) kept[i] = false;
+    }
+    scanAccesses(compiler, source, order, kept);
+    int constants = kept != NULL ? markConstants(compiler->globals, kept) : 0;
+    layoutGlobals(compiler->globals, compiler->image, order, options->pack);
+    if (order != NULL) freeAccessOrder(order);
+    if (kept != NULL) {
+      fprintf(compiler->disassembler->outstream, "%d never written globals inlined, state vector from %u to %u bytes.\n",
+              constants, unpacked, imageLength(compiler->image));
+      FREE(kept);
+    }
+  }
+  if (options->pack) {
+    uint8_t* widths = compiler->image->widths;
+    fprintf(compiler->disassembler->outstream,
+            "State vector packed from %u to %u bytes (bool %u, byte %u, int %u, state %u bits).\n",
+            unpacked, imageLength(compiler->image), widths[typeCfg(VAL_BOOL)], widths[typeCfg(VAL_BYTE)],
+            widths[typeCfg(VAL_INT)], widths[typeCfg(VAL_STATE)]);
+  }
+  /* Show the table state if the verbose option is checked */
+  showTableState(compiler->disassembler, compiler->globals);
+  return false;
+}
+
+
+bool compile(Compiler* compiler, char* source, TokenBuffer* tokens, ProcessIndex* processes, CompileOptions* options) {
+  /* Initialize scanner, or walk the tokens from the first one */
+  compiler->tokens = tokens;
+  compiler->next = 0;
+  initScanner(&compiler->scanner, source);
+  advance(compiler); // Move to the first token
+  if (globalDeclarations(compiler, options, NULL)) return compiler->parser.hadError;
+
+  /* Compile each process in its own chunk, its jumps relative to its start */
+  Partition* partition = initPartition(processes->count);
+  freeChunk(compiler->chunk);
+  compiler->chunk = NULL;
+  /* The verbose output of the workers would interleave */
+  if (options->jobs > 1 && !compiler->disassembler->verbose) {
+    compileParallel(compiler, source, processes, partition, options->jobs);
+  } else {
+    while(!match(compiler, TOKEN_EOF)) {
       compiler->chunk = initChunk();
-      compiler->topTempRegister = &compiler->registers[0];
-      compiler->topGlobRegister = &compiler->registers[REG_NUMBER - 1];
       compiler->pc = 0;
-      targetCount++;
-      if (parser.hadError) return parser.hadError;
+      process(compiler);
+      endProcess(compiler, partition, -1);
+      if (compiler->parser.hadError) break;
+    }
+  }
+  compiler->chunk = initChunk();
+  if (compiler->parser.hadError) {
+    freePartition(partition);
+    return compiler->parser.hadError;
+  }
+
+  /* The object keeps the processes unassigned, they are distributed by a link */
+  if (options->object) {
+    char objectName[256];
+    snprintf(objectName, sizeof(objectName), "%s.o", options->binName);
+    if (!writeObject(partition, compiler->image, objectName)) {
+      fprintf(stderr, "Could not write file \"%s\".\n", objectName);
+      compiler->parser.hadError = true;
+    } else {
+      fprintf(compiler->disassembler->outstream, "Compilation completed. Object of %d processes written.\n", partition->count);
+    }
+    freePartition(partition);
+    return compiler->parser.hadError;
+  }
+  uint32_t instrCount = 0;
+  if (!writeTargets(compiler->disassembler, partition, options, compiler->image, &instrCount)) {
+    compiler->parser.hadError = true;
+  }
+  freePartition(partition);
+  fprintf(compiler->disassembler->outstream, "Compilation completed. Total number of instructions: %u\n", instrCount);
+  return compiler->parser.hadError;
+}
+
+
+/* Number of processes of a source, its pages are given back as the scan goes */
+static int countProcesses(Source* source) {
+  Scanner scanner;
+  initScanner(&scanner, source->chars);
+  int count = 0;
+  for (Token token = scanToken(&scanner) ; token.type != TOKEN_EOF ; token = scanToken(&scanner)) {
+    if (token.type != TOKEN_PROCESS) continue;
+    count++;
+    releaseSource(source, token.start - source->chars);
+  }
+  return count;
+}
+
+
+bool compileStream(Compiler* compiler, Source* source, CompileOptions* options) {
+  /* Only the count mode needs the number of processes beforehand */
+  int expected = options->partition == PARTITION_COUNT ? countProcesses(source) : 0;
+  initScanner(&compiler->scanner, source->chars);
+  compiler->tokens = NULL;
+  advance(compiler); // Move to the first token
+  if (globalDeclarations(compiler, options, source)) return compiler->parser.hadError;
+
+  /* Each process is written to its target then released before the next one is parsed */
+  Stream* stream = initStream(options->nbTargets, options->partition, expected, options->binName);
+  freeChunk(compiler->chunk);
+  while(!match(compiler, TOKEN_EOF)) {
+    compiler->chunk = initChunk();
+    compiler->pc = 0;
+    process(compiler);
+    if (!compiler->parser.hadError && !streamProcess(stream, compiler->chunk)) compiler->parser.hadError = true;
+    freeChunk(compiler->chunk);
+    resetIrProcess(compiler->ir);
+    /* The text before the next process is not read again */
+    releaseSource(source, compiler->parser.current.start - source->chars);
+    if (compiler->parser.hadError) break;
+  }
+  compiler->chunk = initChunk();
+  if (!closeStream(stream)) {
+    fprintf(stderr, "Could not write the binaries \"%s\".\n", options->binName);
+    compiler->parser.hadError = true;
   }
-  fprintf(disassembler->outstream, "Compilation completed. Total number of instructions: %u\n", instrCount);
-  return parser.hadError;
+  if (!compiler->parser.hadError && !writeInitFile(compiler->image, options)) compiler->parser.hadError = true;
+  if (compiler->parser.hadError) {
+    /* Nothing is left behind, as in a batch compilation */
+    discardStream(stream);
+  } else {
+    reportStream(compiler->disassembler->outstream, stream);
+    uint32_t instrCount = 0;
+    for (int t = 0 ; t < stream->nbTargets ; t++) instrCount += stream->targets[t].count;
+    fprintf(compiler->disassembler->outstream, "Compilation completed. Total number of instructions: %u\n", instrCount);
+  }
+  freeStream(stream);
+  return compiler->parser.hadError;
+}
+
+
+/* ==================================
+            LINK ROUTINE
+=================================== */
+
+bool linkPartition(Disassembler* disassembler, Partition* partition, StateImage* image, CompileOptions* options) {
+  uint32_t instrCount = 0;
+  bool written = writeTargets(disassembler, partition, options, image, &instrCount);
+  fprintf(disassembler->outstream, "Link completed. Total number of instructions: %u\n", instrCount);
+  return !written;
+}
+
+
+/* Read an output format from its command line name */
+bool parseOutputFormat(const char* name, OutputFormat* format) {
+  if (strcmp(name, "raw") == 0) {
+    *format = OUTPUT_RAW;
+    return true;
+  }
+  if (strcmp(name, "container") == 0) {
+    *format = OUTPUT_CONTAINER;
+    return true;
+  }
+  return false;
 }
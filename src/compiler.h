@@ -3,10 +3,15 @@
 
 #include "chunk.h"
 #include "disassembler.h"
+#include "image.h"
+#include "ir.h"
 #include "mmemory.h"
+#include "partition.h"
 #include "register.h"
 #include "scanner.h"
+#include "source.h"
 #include "sstring.h"
+#include "stream.h"
 #include "table.h"
 #include "value.h"
 
@@ -14,26 +19,65 @@
         STRUCTS AND GLOBALS
 =================================== */
 
-/* Compiler structure */
+/* Parser structure */
 typedef struct {
+  Token current;  /* current Token being investigated */
+  Token previous; /* next Token being investigated */
+  bool hadError;  /* Previous error was encountered */
+  bool panicMode; /* To avoid cascading errors */
+} Parser;
+
+/* Compiler structure, holds the whole state of a compilation */
+typedef struct {
+  Scanner scanner; /* Scanner over the source being compiled */
+  TokenBuffer* tokens; /* Pre-scanned tokens walked instead of the scanner (NULL to scan lazily) */
+  int next;            /* Index of the next token in the buffer */
+  Parser parser;   /* Parser state */
+  Disassembler* disassembler; /* Verbose output, owned by the caller */
   Table* globals; /* Hash table of the global values (configuration input and output) */
+  StateImage* image; /* Initial state vector, written by the global declarations */
   Chunk* chunk;   /* Chunk of memory containing the instructions */
-  Register* registers;       /* Array of registers behaving like a stack */
-  Register* topTempRegister; /* Pointer to the first register available for temporary variables */
-  Register* topGlobRegister; /* Pointer to the first register available for global variables */
+  Register* registers;       /* Register file shared by temporary and global variables */
   Register* addressRegister; /* Pointer to the register holding the address for array accesses */
+  int* location;        /* Register holding each variable, indexed by its ID (-1 if in memory) */
+  int locationCapacity; /* Size of the location array */
+  IrProcess* ir;  /* Intermediate representation of the process being compiled */
   uint32_t pc;    /* Program counter */
 } Compiler;
 
-/* Compiler singleton */
-extern Compiler* compiler;
-extern Disassembler* disassembler;
+/* Layout of the output binaries */
+typedef enum {
+  OUTPUT_RAW,      /* One file of bare instructions per target */
+  OUTPUT_CONTAINER /* Single file with a header and a section per target */
+} OutputFormat;
+
+/* Options of a compilation */
+typedef struct {
+  int nbTargets;           /* Number of targets the processes are distributed over */
+  PartitionMode partition; /* Distribution strategy */
+  int jobs;                /* Number of threads compiling the processes */
+  char* binName;           /* Prefix of the output binaries */
+  bool object;             /* Write a relocatable object of the processes instead of the binaries */
+  OutputFormat format;     /* Layout of the binaries */
+  bool pack;               /* Size each global to its domain in the state vector */
+  bool reorder;            /* Lay the globals out in the order the processes access them */
+  bool inlineConstants;    /* Read the globals no process writes as immediates, out of the state vector */
+} CompileOptions;
 
 /* Allocation/Deallocation routine */
-void initCompiler();
-void freeCompiler();
+Compiler* initCompiler(Disassembler* disassembler);
+void freeCompiler(Compiler* compiler);
+
+/* Compile routine, the tokens are either scanned from the source or read from a buffer
+   left untouched (so it can be shared by several compilations) */
+bool compile(Compiler* compiler, char* source, TokenBuffer* tokens, ProcessIndex* processes, CompileOptions* options);
+/* Compile routine with a memory bounded by the globals and one process: the processes are parsed
+   from a window over the source and written to their target as soon as they are compiled */
+bool compileStream(Compiler* compiler, Source* source, CompileOptions* options);
 
-/* Compile routine */
-bool compile(char* source, int nbTargets, int nbGA, char* binName);
+/* Link routine, distribute processes read from objects over the targets and write their binaries */
+bool linkPartition(Disassembler* disassembler, Partition* partition, StateImage* image, CompileOptions* options);
+/* Read an output format from its command line name */
+bool parseOutputFormat(const char* name, OutputFormat* format);
 
 #endif
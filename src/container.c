@@ -0,0 +1,133 @@
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "container.h"
+#include "mmemory.h"
+
+/* ==================================
+              WRITING
+=================================== */
+
+/* Offset of the first section, after the header and a section table of a given size */
+static uint64_t firstSection(int sectionCount) {
+  uint64_t tableEnd = sizeof(ContainerHeader) + (uint64_t)sectionCount * sizeof(ContainerSection);
+  return (tableEnd + CONTAINER_ALIGN - 1) / CONTAINER_ALIGN * CONTAINER_ALIGN;
+}
+
+
+/* Open a container, the table has room for a given number of sections */
+Container* openContainer(const char* path, uint32_t targetCount, uint32_t stateSize, const uint8_t* typeWidths,
+                         int sectionCount) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) return NULL;
+  Container* container = ALLOCATE_OBJ(Container);
+  container->file = file;
+  container->header.magic = CONTAINER_MAGIC;
+  container->header.version = CONTAINER_VERSION;
+  container->header.isaVersion = ISA_VERSION;
+  container->header.targetCount = targetCount;
+  container->header.stateSize = stateSize;
+  container->header.sectionCount = 0;
+  memcpy(container->header.typeWidths, typeWidths, sizeof(container->header.typeWidths));
+  container->sectionCapacity = sectionCount;
+  container->sections = sectionCount > 0 ? ALLOCATE_ARRAY(ContainerSection, sectionCount) : NULL;
+  container->end = firstSection(sectionCount);
+  container->failed = false;
+  return container;
+}
+
+
+/* Append a section, aligned on a page */
+void addSection(Container* container, SectionType type, uint32_t index, const void* content, size_t length) {
+  /* The sections follow the table, it can not grow */
+  if ((int)container->header.sectionCount == container->sectionCapacity) {
+    container->failed = true;
+    return;
+  }
+  ContainerSection* section = &container->sections[container->header.sectionCount++];
+  section->type = type;
+  section->index = index;
+  section->offset = container->end;
+  section->length = length;
+  if (length > 0) {
+    container->failed |= fseek(container->file, (long)section->offset, SEEK_SET) != 0;
+    container->failed |= fwrite(content, 1, length, container->file) != length;
+  }
+  container->end = (section->offset + length + CONTAINER_ALIGN - 1) / CONTAINER_ALIGN * CONTAINER_ALIGN;
+}
+
+
+/* Write the header and section table then close the file */
+bool closeContainer(Container* container) {
+  bool written = !container->failed;
+  written &= fseek(container->file, 0, SEEK_SET) == 0;
+  written &= fwrite(&container->header, sizeof(ContainerHeader), 1, container->file) == 1;
+  written &= fwrite(container->sections, sizeof(ContainerSection), container->header.sectionCount,
+                    container->file) == container->header.sectionCount;
+  /* The file ends on the alignment, the last section can be mapped as whole pages */
+  written &= fflush(container->file) == 0;
+  written &= ftruncate(fileno(container->file), (off_t)container->end) == 0;
+  written &= fclose(container->file) == 0;
+  FREE(container->sections);
+  FREE(container);
+  return written;
+}
+
+
+/* ==================================
+              READING
+=================================== */
+
+/* Map a container and check its header and section table */
+ContainerView mapContainer(const char* path) {
+  ContainerView view = {NULL, NULL, NULL, 0};
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return view;
+  struct stat status;
+  if (fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof(ContainerHeader)) {
+    close(fd);
+    return view;
+  }
+  void* base = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) return view;
+  view.base = (uint8_t*)base;
+  view.size = status.st_size;
+  ContainerHeader* header = (ContainerHeader*)view.base;
+  bool valid = header->magic == CONTAINER_MAGIC && header->version == CONTAINER_VERSION &&
+               header->isaVersion == ISA_VERSION &&
+               sizeof(ContainerHeader) + (uint64_t)header->sectionCount * sizeof(ContainerSection) <= view.size;
+  for (uint32_t i = 0 ; valid && i < header->sectionCount ; i++) {
+    ContainerSection* section = (ContainerSection*)(view.base + sizeof(ContainerHeader)) + i;
+    valid = section->offset <= view.size && section->length <= view.size - section->offset;
+  }
+  if (!valid) {
+    unmapContainer(&view);
+    return view;
+  }
+  view.header = header;
+  view.sections = (ContainerSection*)(view.base + sizeof(ContainerHeader));
+  return view;
+}
+
+
+/* Content of a section of a mapped container */
+const void* sectionContent(ContainerView* view, int section) {
+  return view->base + view->sections[section].offset;
+}
+
+
+/* Unmap a container */
+void unmapContainer(ContainerView* view) {
+  if (view->base != NULL) munmap(view->base, view->size);
+  view->base = NULL;
+  view->header = NULL;
+}
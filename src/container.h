@@ -0,0 +1,79 @@
+#ifndef sdvu_container_h
+#define sdvu_container_h
+
+#include <stdio.h>
+
+#include "common.h"
+
+/* ==================================
+        STRUCTS AND GLOBALS
+=================================== */
+
+/* Single file holding the binaries of every target. A header and a section table are followed by
+   the sections, each one starting on a page boundary so a loader can map the file once and hand
+   each section over without a copy. All the fields are native words. */
+#define CONTAINER_MAGIC   0x42564453 /* "SDVB" */
+#define CONTAINER_VERSION 2
+/* Version of the instruction set of the code sections */
+#define ISA_VERSION       1
+/* Alignment of the sections in the file */
+#define CONTAINER_ALIGN   4096
+
+/* Content of a section */
+typedef enum {
+  SECTION_CODE = 1, /* Instructions of a target, index is the target */
+  SECTION_INIT = 2  /* Initial state vector image (see image.h), index is 0 */
+} SectionType;
+
+/* Header at the start of the file */
+typedef struct {
+  uint32_t magic;        /* CONTAINER_MAGIC */
+  uint16_t version;      /* CONTAINER_VERSION */
+  uint16_t isaVersion;   /* ISA_VERSION */
+  uint32_t targetCount;  /* Number of targets, each has a code section (empty if no process) */
+  uint32_t stateSize;    /* Size of the state vector in bits */
+  uint32_t sectionCount; /* Number of entries of the section table following the header */
+  uint8_t typeWidths[4]; /* Width in bits of a value of each type code of the LOAD/STORE instructions */
+} ContainerHeader;
+
+/* Entry of the section table */
+typedef struct {
+  uint32_t type;   /* SectionType */
+  uint32_t index;  /* Target of a code section */
+  uint64_t offset; /* Offset of the section in the file, a multiple of CONTAINER_ALIGN */
+  uint64_t length; /* Length of the section in bytes */
+} ContainerSection;
+
+/* Container being written, its sections are appended one at a time */
+typedef struct {
+  FILE* file;                 /* Output file */
+  ContainerHeader header;     /* Header written once every section is known */
+  ContainerSection* sections; /* Section table */
+  int sectionCapacity;        /* Number of sections the table has room for */
+  uint64_t end;               /* Offset following the last section */
+  bool failed;                /* A write failed */
+} Container;
+
+/* Container mapped for reading */
+typedef struct {
+  ContainerHeader* header;     /* Header, NULL if the file is not a container */
+  ContainerSection* sections;  /* Section table */
+  uint8_t* base;               /* Start of the mapping */
+  size_t size;                 /* Size of the mapping */
+} ContainerView;
+
+/* Writing routine, the number of sections is known beforehand and the header and section table
+   are written by the close */
+Container* openContainer(const char* path, uint32_t targetCount, uint32_t stateSize, const uint8_t* typeWidths,
+                         int sectionCount);
+void addSection(Container* container, SectionType type, uint32_t index, const void* content, size_t length);
+/* Close the container, false if it could not be written */
+bool closeContainer(Container* container);
+
+/* Reading routine, the view has a NULL header if the file is not a valid container */
+ContainerView mapContainer(const char* path);
+/* Content of a section of a mapped container */
+const void* sectionContent(ContainerView* view, int section);
+void unmapContainer(ContainerView* view);
+
+#endif
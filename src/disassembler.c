@@ -2,10 +2,9 @@
 #include <stdlib.h>
 
 #include "chunk.h"
+#include "container.h"
 #include "disassembler.h"
 
-Disassembler* disassembler;
-
 char* binOps[] = {
   [OP_ADD]   = "OP_ADD",
   [OP_SUB]   = "OP_SUB",
@@ -46,17 +45,18 @@ char* storeConfigs[] = {
 };
 
 
-void initDisassembler(bool verbose, FILE* outstream) {
-  disassembler = ALLOCATE_OBJ(Disassembler);
+Disassembler* initDisassembler(bool verbose, FILE* outstream) {
+  Disassembler* disassembler = ALLOCATE_OBJ(Disassembler);
   disassembler->verbose = verbose;
   disassembler->outstream = outstream;
+  return disassembler;
 }
 
-void freeDisassembler() {
+void freeDisassembler(Disassembler* disassembler) {
   FREE(disassembler);
 }
 
-void disassembleInstruction(uint32_t bitInstruction) {
+void disassembleInstruction(Disassembler* disassembler, uint32_t bitInstruction) {
   /* If not verbose quit immediately */
   if (!disassembler->verbose) return;
   FILE* outstream = disassembler->outstream;
@@ -156,22 +156,27 @@ void disassembleInstruction(uint32_t bitInstruction) {
 }
 
 /* Prints the table state if the verbose option is checked */
-void showTableState(Table* table) {
+void showTableState(Disassembler* disassembler, Table* table) {
   /* If not verbose quit immediately */
   if (!disassembler->verbose) return;
   FILE* outstream = disassembler->outstream;
   fprintf(outstream, "=== Global Variables Hash Table ===\n");
-  for (int i = 0 ; i < table->capacity ; i++) {
-    if (!IS_NIL(table->entries[i].value)) {
-      fprintf(outstream, "[%2i] - Variable named %8s with value '", i, table->entries[i].key->chars);
-      fprintValue(outstream, table->entries[i].value);
-      fprintf(outstream, "' at address %u\n", table->entries[i].address);
+  for (int i = 0 ; i < table->symbolCount ; i++) {
+    Entry* entry = &table->symbols[i];
+    if (entry->key != NULL) {
+      fprintf(outstream, "[%2i] - Variable named %8s with value '", i, entry->key->chars);
+      fprintValue(outstream, entry->value);
+      if (entry->constant) {
+        fprintf(outstream, "' inlined\n");
+      } else {
+        fprintf(outstream, "' at address %u\n", entry->address);
+      }
     }
   }
   fprintf(outstream, "=== --------------------------- ===\n");
 }
 
-void showRegisterState(Register* registers, Register* topTempRegister, Register* topGlobRegister, Register* addressRegister) {
+void showRegisterState(Disassembler* disassembler, Register* registers, Register* addressRegister) {
   /* If not verbose quit immediately */
   if (!disassembler->verbose) return;
   FILE* outstream = disassembler->outstream;
@@ -183,12 +188,8 @@ void showRegisterState(Register* registers, Register* topTempRegister, Register*
       fprintf(outstream, "[%2i] - Empty                  ", i);
     }
 
-    if (i == topTempRegister->number && i == topGlobRegister->number) {
-      fprintf(outstream, " << TOP Temp | TOP Glob\n");
-    } else if (i == topTempRegister->number) {
-      fprintf(outstream, " < TOP Temp\n");
-    } else if (i == topGlobRegister->number) {
-      fprintf(outstream, " < TOP Glob\n");
+    if (registers[i].isDirty) {
+      fprintf(outstream, " < Dirty\n");
     } else {
       fprintf(outstream, "\n");
     }
@@ -203,18 +204,36 @@ void showRegisterState(Register* registers, Register* topTempRegister, Register*
   fprintf(outstream, "=== --------------- ===\n");
 }
 
-void disassembleChunk(Chunk* chunk) {
+void disassembleChunk(Disassembler* disassembler, Chunk* chunk) {
   /* If not verbose quit immediately */
   if (!disassembler->verbose) return;
   FILE* outstream = disassembler->outstream;
   fprintf(outstream,"=== Disassembling resulting chunk ===\n");
   for (int i = 0 ; i < chunk->capacity ; i++) {
-    disassembleInstruction(chunk->instructions[i]);
+    disassembleInstruction(disassembler, chunk->instructions[i]);
   }
   fprintf(outstream, "=== ----------------------------- ===\n");
 }
 
-void disassembleBinary(const char* path) {
+void disassembleBinary(Disassembler* disassembler, const char* path) {
+  /* A container is mapped once and its code sections are disassembled in place */
+  ContainerView view = mapContainer(path);
+  if (view.header != NULL) {
+    uint8_t* widths = view.header->typeWidths;
+    fprintf(disassembler->outstream, "Container of %u targets, state vector of %u bits (type widths %u/%u/%u/%u)\n",
+            view.header->targetCount, view.header->stateSize, widths[0], widths[1], widths[2], widths[3]);
+    for (uint32_t i = 0 ; i < view.header->sectionCount ; i++) {
+      ContainerSection* section = &view.sections[i];
+      if (section->type != SECTION_CODE) continue;
+      fprintf(disassembler->outstream, "== Target %u ==\n", section->index);
+      const uint32_t* instructions = sectionContent(&view, i);
+      for (uint64_t j = 0 ; j < section->length / sizeof(uint32_t) ; j++) {
+        disassembleInstruction(disassembler, instructions[j]);
+      }
+    }
+    unmapContainer(&view);
+    return;
+  }
   /* Create buffer to read into */
   uint32_t buf;
   /* Open the file to read */
@@ -222,7 +241,7 @@ void disassembleBinary(const char* path) {
   if (file == NULL) exit(64);
   /* Loop over, fill the buffer then disassemble */
   while (fread(&buf, sizeof(buf), 1, file) == 1) {
-      disassembleInstruction(buf);
+      disassembleInstruction(disassembler, buf);
   }
   fclose(file);
 }
@@ -20,12 +20,12 @@ typedef struct {
   FILE* outstream;
 } Disassembler;
 
-void initDisassembler(bool verbose, FILE* outstream);
-void freeDisassembler();
-void disassembleInstruction(uint32_t bitInstruction);
-void showTableState(Table* table);
-void showRegisterState(Register* registers, Register* topTempRegister, Register* topGlobRegister, Register* addressRegister);
-void disassembleChunk(Chunk* chunk);
-void disassembleBinary(const char* fileContent);
+Disassembler* initDisassembler(bool verbose, FILE* outstream);
+void freeDisassembler(Disassembler* disassembler);
+void disassembleInstruction(Disassembler* disassembler, uint32_t bitInstruction);
+void showTableState(Disassembler* disassembler, Table* table);
+void showRegisterState(Disassembler* disassembler, Register* registers, Register* addressRegister);
+void disassembleChunk(Disassembler* disassembler, Chunk* chunk);
+void disassembleBinary(Disassembler* disassembler, const char* fileContent);
 
 #endif
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "chunk.h"
+#include "common.h"
+#include "image.h"
+#include "mmemory.h"
+#include "value.h"
+
+/* ==================================
+      ALLOCATION - DEALLOCATION
+=================================== */
+
+/* Initialize an empty image */
+StateImage* initStateImage() {
+  StateImage* image = ALLOCATE_OBJ(StateImage);
+  image->size = 0;
+  image->capacity = 0;
+  image->bytes = NULL;
+  /* Every value on whole bytes, the widths of the instruction types */
+  image->widths[typeCfg(VAL_BOOL)]  = BOOL_SIZE;
+  image->widths[typeCfg(VAL_BYTE)]  = BYTE_SIZE;
+  image->widths[typeCfg(VAL_INT)]   = INT_SIZE;
+  image->widths[typeCfg(VAL_STATE)] = STATE_SIZE;
+  return image;
+}
+
+
+/* Free an image */
+void freeStateImage(StateImage* image) {
+  FREE(image->bytes);
+  FREE(image);
+}
+
+
+/* ==================================
+          IMAGE OPERATIONS
+=================================== */
+
+/* Bits of a value as stored in the state vector */
+uint32_t valueBits(Value value) {
+  switch (value.type) {
+    case VAL_BOOL:  return AS_BOOL(value) ? 1 : 0;
+    case VAL_BYTE:  return AS_BYTE(value);
+    case VAL_INT:   return (uint32_t)AS_INT(value);
+    case VAL_STATE: return (uint32_t)AS_STATE(value).currentState;
+    default:        return 0;
+  }
+}
+
+
+/* Width in bits of a value of a given type */
+uint32_t typeWidth(StateImage* image, ValueType type) {
+  return image->widths[typeCfg(type)];
+}
+
+
+/* Grow the image to a given size in bits */
+void sizeImage(StateImage* image, uint32_t size) {
+  uint32_t length = (size + 7) / 8;
+  if (length > image->capacity) {
+    uint32_t oldCapacity = image->capacity;
+    while (image->capacity < length) image->capacity = GROW_CAPACITY(image->capacity);
+    image->bytes = GROW_ARRAY(uint8_t, image->bytes, image->capacity);
+    memset(image->bytes + oldCapacity, 0, image->capacity - oldCapacity);
+  }
+  if (size > image->size) image->size = size;
+}
+
+
+/* Set the value of an element of a global */
+void setImageValue(StateImage* image, uint32_t address, uint32_t width, Value value) {
+  setImageBits(image, address, width, valueBits(value));
+}
+
+
+/* Raw bits of a field of the image */
+uint32_t imageBits(StateImage* image, uint32_t address, uint32_t width) {
+  uint32_t bits = 0;
+  for (uint32_t i = 0 ; i < width && i < 32 && address + i < image->size ; i++) {
+    uint32_t bit = address + i;
+    bits |= (uint32_t)((image->bytes[bit / 8] >> (bit % 8)) & 1) << i;
+  }
+  return bits;
+}
+
+
+/* Set the raw bits of a field, the image grows to cover it */
+void setImageBits(StateImage* image, uint32_t address, uint32_t width, uint32_t bits) {
+  sizeImage(image, address + width);
+  /* Bit by bit, the addresses of a packed layout are not on bytes */
+  for (uint32_t i = 0 ; i < width ; i++) {
+    uint32_t bit = address + i;
+    uint8_t mask = (uint8_t)(1 << (bit % 8));
+    bool set = i < 32 && ((bits >> i) & 1);
+    image->bytes[bit / 8] = set ? image->bytes[bit / 8] | mask : image->bytes[bit / 8] & ~mask;
+  }
+}
+
+
+/* Number of bytes covering the state vector */
+uint32_t imageLength(StateImage* image) {
+  return (image->size + 7) / 8;
+}
+
+
+/* The widths differ from the ones of a new image */
+bool packedWidths(StateImage* image) {
+  return image->widths[typeCfg(VAL_BOOL)]  != BOOL_SIZE || image->widths[typeCfg(VAL_BYTE)]  != BYTE_SIZE ||
+         image->widths[typeCfg(VAL_INT)]   != INT_SIZE  || image->widths[typeCfg(VAL_STATE)] != STATE_SIZE;
+}
+
+
+/* Write the image to a file */
+bool writeImage(StateImage* image, const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) return false;
+  bool written = fwrite(image->bytes, 1, imageLength(image), file) == imageLength(image);
+  written &= fclose(file) == 0;
+  return written;
+}
+
+
+/* Write the widths to a file */
+bool writeWidths(StateImage* image, const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) return false;
+  bool written = fwrite(image->widths, 1, TYPE_CODES, file) == TYPE_CODES;
+  written &= fclose(file) == 0;
+  return written;
+}
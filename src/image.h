@@ -0,0 +1,50 @@
+#ifndef sdvu_image_h
+#define sdvu_image_h
+
+#include "common.h"
+#include "value.h"
+
+/* ==================================
+        STRUCTS AND GLOBALS
+=================================== */
+
+/* Number of type codes of the LOAD/STORE instructions */
+#define TYPE_CODES 4
+
+/* Initial value of the state vector, laid out at the addresses of the globals table so the host
+   can copy it as is in BRAM. Bit n of the vector is bit n % 8 of byte n / 8, a value spans its
+   width from its address with the least significant bit first (little endian on whole bytes). */
+typedef struct {
+  uint32_t size;     /* Size of the state vector in bits */
+  uint32_t capacity; /* Number of bytes allocated */
+  uint8_t* bytes;    /* Content of the vector, zero outside of the declared values */
+  uint8_t widths[TYPE_CODES]; /* Width in bits of a value of each type code (see typeCfg) */
+} StateImage;
+
+/* Allocation/Deallocation routine */
+StateImage* initStateImage();
+void freeStateImage(StateImage* image);
+
+/* Bits of a value as stored in the state vector (two's complement for a negative int) */
+uint32_t valueBits(Value value);
+/* Width in bits of a value of a given type in the layout of the image */
+uint32_t typeWidth(StateImage* image, ValueType type);
+/* Grow the image to a given size in bits, the new bits are zero */
+void sizeImage(StateImage* image, uint32_t size);
+/* Set the value of the element of a global at a given address and width (in bits), the image
+   grows to cover it */
+void setImageValue(StateImage* image, uint32_t address, uint32_t width, Value value);
+/* Raw bits of a field of the image (up to 32), the bits beyond the image are zero */
+uint32_t imageBits(StateImage* image, uint32_t address, uint32_t width);
+void setImageBits(StateImage* image, uint32_t address, uint32_t width, uint32_t bits);
+/* Number of bytes covering the state vector */
+uint32_t imageLength(StateImage* image);
+/* The widths are not those of the whole bytes layout (a packed layout) */
+bool packedWidths(StateImage* image);
+/* Write the image to a file, false if it could not be written */
+bool writeImage(StateImage* image, const char* path);
+/* Write the widths of the four LOAD/STORE types to a file (a byte each, by type code), false if it could
+   not be written */
+bool writeWidths(StateImage* image, const char* path);
+
+#endif
@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "chunk.h"
+#include "ir.h"
+#include "mmemory.h"
+#include "sstring.h"
+
+/* ==================================
+             OPERANDS
+=================================== */
+
+/* Unused operand */
+Operand noOperand() {
+  Operand operand;
+  operand.type = OPERAND_NONE;
+  operand.imm = 0;
+  operand.name = NULL;
+  operand.symbol = -1;
+  operand.address = 0;
+  operand.valueType = VAL_NIL;
+  return operand;
+}
+
+
+/* Immediate value operand */
+Operand immOperand(int value) {
+  Operand operand = noOperand();
+  operand.type = OPERAND_IMM;
+  operand.imm = value;
+  return operand;
+}
+
+
+/* Temporary variable operand */
+Operand tempOperand(String* name, int symbol) {
+  Operand operand = noOperand();
+  operand.type = OPERAND_TEMP;
+  operand.name = name;
+  operand.symbol = symbol;
+  return operand;
+}
+
+
+/* Global variable operand */
+Operand globalOperand(String* name, int symbol, uint32_t address, ValueType valueType) {
+  Operand operand = noOperand();
+  operand.type = OPERAND_GLOBAL;
+  operand.name = name;
+  operand.symbol = symbol;
+  operand.address = address;
+  operand.valueType = valueType;
+  return operand;
+}
+
+
+/* Two operands hold the same value */
+bool operandsEqual(Operand a, Operand b) {
+  if (a.type != b.type) return false;
+  switch (a.type) {
+    case OPERAND_NONE:   return true;
+    case OPERAND_IMM:    return a.imm == b.imm;
+    case OPERAND_TEMP:
+    case OPERAND_GLOBAL: return a.symbol == b.symbol;
+    default: return false; // Unreachable
+  }
+}
+
+
+/* The operand designates a temporary or global variable */
+bool isVariable(Operand operand) {
+  return operand.type == OPERAND_TEMP || operand.type == OPERAND_GLOBAL;
+}
+
+
+/* ==================================
+           IR OPERATIONS
+=================================== */
+
+/* The operation reads a given variable */
+bool readsVariable(IrOp* op, int symbol) {
+  return (isVariable(op->a) && op->a.symbol == symbol) ||
+         (isVariable(op->b) && op->b.symbol == symbol);
+}
+
+
+/* Zero an operation of a given type */
+IrOp initIrOp(IrOpType type, int line) {
+  IrOp op;
+  op.type = type;
+  op.op_code = OP_NOP;
+  op.negated = false;
+  op.dst = noOperand();
+  op.a = noOperand();
+  op.b = noOperand();
+  op.array = NULL;
+  op.arraySymbol = -1;
+  op.base = 0;
+  op.elemType = VAL_NIL;
+  op.elemSize = 0;
+  op.line = line;
+  return op;
+}
+
+
+/* IR process initialization */
+IrProcess* initIrProcess() {
+  IrProcess* process = ALLOCATE_OBJ(IrProcess);
+  process->count = 0;
+  process->capacity = 0;
+  process->ops = NULL;
+  process->guardIndex = -1;
+  process->tempCount = 0;
+  process->firstTemp = 0;
+  process->tempNameCount = 0;
+  process->tempNameCapacity = 0;
+  process->tempNames = NULL;
+  process->arena = initArena();
+  return process;
+}
+
+
+/* Empty the process, the operations array and the arena memory are kept for the next process */
+void resetIrProcess(IrProcess* process) {
+  process->count = 0;
+  process->guardIndex = -1;
+  process->tempCount = 0;
+  process->tempNameCount = 0;
+  resetArena(process->arena);
+}
+
+
+/* Free the IR process */
+void freeIrProcess(IrProcess* process) {
+  freeArena(process->arena);
+  FREE(process->tempNames);
+  FREE(process->ops);
+  FREE(process);
+}
+
+
+/* Append an operation to the process */
+int writeIrOp(IrProcess* process, IrOp op) {
+  if (process->capacity < process->count + 1) {
+    int oldCapacity = process->capacity;
+    process->capacity = GROW_CAPACITY(oldCapacity);
+    process->ops = GROW_ARRAY(IrOp, process->ops, process->capacity);
+  }
+  process->ops[process->count] = op;
+  return process->count++;
+}
+
+
+/* Turn an operation into a NOP */
+void removeIrOp(IrOp* op) {
+  *op = initIrOp(IR_NOP, op->line);
+}
+
+
+/* Drop the NOP operations, keeping the index of the guard up to date */
+void compactIrProcess(IrProcess* process) {
+  int count = 0;
+  for (int i = 0 ; i < process->count ; i++) {
+    if (process->ops[i].type == IR_NOP) continue;
+    if (i == process->guardIndex) process->guardIndex = count;
+    process->ops[count++] = process->ops[i];
+  }
+  process->count = count;
+}
+
+
+/* Give the next ID to a temporary */
+static Operand addTemp(IrProcess* process, String* name) {
+  if (process->tempNameCapacity < process->tempNameCount + 1) {
+    int oldCapacity = process->tempNameCapacity;
+    process->tempNameCapacity = GROW_CAPACITY(oldCapacity);
+    process->tempNames = GROW_ARRAY(String*, process->tempNames, process->tempNameCapacity);
+  }
+  process->tempNames[process->tempNameCount] = name;
+  return tempOperand(name, process->firstTemp + process->tempNameCount++);
+}
+
+
+/* Compiler temporaries are named t_#<n>, a name the scanner can not produce */
+Operand newTemp(IrProcess* process) {
+  char name[16];
+  int length = snprintf(name, 16, "t_#%d", process->tempCount++);
+  return addTemp(process, irName(process, name, length));
+}
+
+
+/* The temporaries of a process are few, they are looked up without hashing */
+Operand namedTemp(IrProcess* process, const char* chars, int length) {
+  for (int i = 0 ; i < process->tempNameCount ; i++) {
+    String* name = process->tempNames[i];
+    if (name->length == length && memcmp(name->chars, chars, length) == 0) {
+      return tempOperand(name, process->firstTemp + i);
+    }
+  }
+  return addTemp(process, irName(process, chars, length));
+}
+
+
+/* Globals and temporaries of the process */
+int symbolCount(IrProcess* process) {
+  return process->firstTemp + process->tempNameCount;
+}
+
+
+/* Names of a process are released all at once when it is reset */
+String* irName(IrProcess* process, const char* chars, int length) {
+  return arenaString(process->arena, chars, length);
+}
+
+
+/* ==================================
+              PRINTING
+=================================== */
+
+static const char* irOpNames[] = {
+  [OP_ADD] = "+",  [OP_SUB] = "-", [OP_MUL] = "*",
+  [OP_DIV] = "/",  [OP_MOD] = "%", [OP_AND] = "and",
+  [OP_OR]  = "or", [OP_LT]  = "<", [OP_GT]  = ">",
+  [OP_EQ]  = "=="
+};
+
+/* Print an operand */
+void fprintOperand(FILE* outstream, Operand operand) {
+  switch (operand.type) {
+    case OPERAND_NONE:   fprintf(outstream, "_"); break;
+    case OPERAND_IMM:    fprintf(outstream, "%d", operand.imm); break;
+    case OPERAND_TEMP:   fprintf(outstream, "%s", operand.name->chars); break;
+    case OPERAND_GLOBAL: fprintf(outstream, "@%s", operand.name->chars); break;
+  }
+}
+
+
+/* Print the operations of a process */
+void fprintIrProcess(FILE* outstream, IrProcess* process) {
+  fprintf(outstream, "=== Process IR ===\n");
+  for (int i = 0 ; i < process->count ; i++) {
+    IrOp* op = &process->ops[i];
+    fprintf(outstream, "%4d  ", i);
+    switch (op->type) {
+      case IR_ASSIGN:
+        fprintOperand(outstream, op->dst);
+        fprintf(outstream, " = %s", op->negated ? "not " : "");
+        fprintOperand(outstream, op->a);
+        break;
+      case IR_BINARY:
+        fprintOperand(outstream, op->dst);
+        fprintf(outstream, " = %s", op->negated ? "not (" : "");
+        fprintOperand(outstream, op->a);
+        fprintf(outstream, " %s ", irOpNames[op->op_code]);
+        fprintOperand(outstream, op->b);
+        if (op->negated) fprintf(outstream, ")");
+        break;
+      case IR_LOAD_ELEM:
+        fprintOperand(outstream, op->dst);
+        fprintf(outstream, " = @%s[", op->array->chars);
+        fprintOperand(outstream, op->a);
+        fprintf(outstream, "]");
+        break;
+      case IR_STORE_ELEM:
+        fprintf(outstream, "@%s[", op->array->chars);
+        fprintOperand(outstream, op->a);
+        fprintf(outstream, "] = ");
+        fprintOperand(outstream, op->b);
+        break;
+      case IR_GUARD:
+        fprintf(outstream, "guard ");
+        fprintOperand(outstream, op->a);
+        break;
+      case IR_NOP:
+        fprintf(outstream, "nop");
+        break;
+    }
+    fprintf(outstream, "\n");
+  }
+  fprintf(outstream, "=== ----------- ===\n");
+}
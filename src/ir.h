@@ -0,0 +1,109 @@
+#ifndef sdvu_ir_h
+#define sdvu_ir_h
+
+#include "common.h"
+#include "mmemory.h"
+#include "sstring.h"
+#include "value.h"
+
+/* ==================================
+        INTERMEDIATE REPRESENTATION
+=================================== */
+
+/* Kind of value an operand refers to */
+typedef enum {
+  OPERAND_NONE,   /* Unused operand */
+  OPERAND_IMM,    /* Immediate value */
+  OPERAND_TEMP,   /* Temporary variable, virtual register assigned once */
+  OPERAND_GLOBAL  /* Global variable, backed by memory */
+} OperandType;
+
+/* Operand of an IR operation */
+typedef struct {
+  OperandType type;
+  int imm;              /* Immediate value */
+  String* name;         /* Name of the variable */
+  int symbol;           /* ID of the variable, globals first then the temporaries of the process */
+  uint32_t address;     /* Address of a global variable */
+  ValueType valueType;  /* Type of a global variable */
+} Operand;
+
+/* IR operations, three-address code over virtual registers */
+typedef enum {
+  IR_ASSIGN,      /* dst = a                                     */
+  IR_BINARY,      /* dst = a op b                                */
+  IR_LOAD_ELEM,   /* dst = array[a]                              */
+  IR_STORE_ELEM,  /* array[a] = b                                */
+  IR_GUARD,       /* Skip the rest of the process if a is false  */
+  IR_NOP          /* Removed by an optimization pass             */
+} IrOpType;
+
+/* IR operation */
+typedef struct {
+  IrOpType type;
+  unsigned int op_code; /* Operation code of a binary operation */
+  bool negated;         /* The result is negated once computed */
+  Operand dst;          /* Destination */
+  Operand a;            /* Left operand (index of an array access) */
+  Operand b;            /* Right operand (value stored in an array element) */
+  String* array;        /* Name of the accessed array */
+  int arraySymbol;      /* ID of the accessed array */
+  uint32_t base;        /* Base address of the accessed array */
+  ValueType elemType;   /* Type of the array elements */
+  int elemSize;         /* Size of an array element in bits */
+  int line;             /* Line in the source for error reporting */
+} IrOp;
+
+/* IR of a process: guard block, guards then effect */
+typedef struct {
+  int count;       /* Number of operations */
+  int capacity;    /* Size of the operations array */
+  IrOp* ops;       /* Operations in program order */
+  int guardIndex;  /* Index of the last IR_GUARD operation, the effect follows (-1 before the guard condition) */
+  int tempCount;   /* Number of compiler-generated temporaries */
+  int firstTemp;   /* ID of the first temporary, the IDs below are the globals */
+  int tempNameCount;    /* Number of temporaries, compiler-generated or not */
+  int tempNameCapacity; /* Size of the temporaries array */
+  String** tempNames;   /* Names of the temporaries, indexed by their ID minus firstTemp */
+  Arena* arena;    /* Names and other objects living until the end of the process */
+} IrProcess;
+
+/* Operand creation */
+Operand noOperand();
+Operand immOperand(int value);
+Operand tempOperand(String* name, int symbol);
+Operand globalOperand(String* name, int symbol, uint32_t address, ValueType valueType);
+/* Operand comparison (same immediate or same variable) */
+bool operandsEqual(Operand a, Operand b);
+/* The operand designates a variable */
+bool isVariable(Operand operand);
+
+/* IR operation initialization */
+IrOp initIrOp(IrOpType type, int line);
+/* The operation reads a given variable (operand or array index) */
+bool readsVariable(IrOp* op, int symbol);
+
+/* IR process operations */
+IrProcess* initIrProcess();
+void freeIrProcess(IrProcess* process);
+/* Empty the process so that it can be reused for the next one, its arena is released */
+void resetIrProcess(IrProcess* process);
+/* Append an operation, returns its index */
+int writeIrOp(IrProcess* process, IrOp op);
+/* Turn an operation into a NOP */
+void removeIrOp(IrOp* op);
+/* Drop the NOP operations */
+void compactIrProcess(IrProcess* process);
+/* Create a fresh compiler temporary */
+Operand newTemp(IrProcess* process);
+/* Temporary named in the source, the same name gives the same ID within a process */
+Operand namedTemp(IrProcess* process, const char* chars, int length);
+/* Number of IDs in use, globals and temporaries */
+int symbolCount(IrProcess* process);
+/* Name allocated in the process arena */
+String* irName(IrProcess* process, const char* chars, int length);
+/* Textual representation */
+void fprintOperand(FILE* outstream, Operand operand);
+void fprintIrProcess(FILE* outstream, IrProcess* process);
+
+#endif
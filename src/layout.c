@@ -0,0 +1,159 @@
+#include <string.h>
+
+#include "chunk.h"
+#include "common.h"
+#include "image.h"
+#include "layout.h"
+#include "mmemory.h"
+#include "table.h"
+#include "value.h"
+
+/* ==================================
+           ACCESS ORDER
+=================================== */
+
+/* Initialize an empty order over the symbols of a table */
+AccessOrder* initAccessOrder(Table* globals) {
+  AccessOrder* order = ALLOCATE_OBJ(AccessOrder);
+  order->count = 0;
+  order->capacity = globals->symbolCount;
+  order->symbols = ALLOCATE_ARRAY(int, order->capacity > 0 ? order->capacity : 1);
+  order->placed = ALLOCATE_ARRAY(bool, order->capacity > 0 ? order->capacity : 1);
+  for (int i = 0 ; i < order->capacity ; i++) order->placed[i] = false;
+  return order;
+}
+
+
+/* Free an order */
+void freeAccessOrder(AccessOrder* order) {
+  FREE(order->symbols);
+  FREE(order->placed);
+  FREE(order);
+}
+
+
+/* Place a global named by a process */
+void accessGlobal(AccessOrder* order, int symbol) {
+  if (symbol < 0 || symbol >= order->capacity || order->placed[symbol]) return;
+  order->placed[symbol] = true;
+  order->symbols[order->count++] = symbol;
+}
+
+
+/* Place the globals no process named, in the order of their declarations */
+void endAccessOrder(AccessOrder* order) {
+  for (int i = 0 ; i < order->capacity ; i++) accessGlobal(order, i);
+}
+
+
+/* ==================================
+             CONSTANTS
+=================================== */
+
+int markConstants(Table* globals, bool* kept) {
+  int count = 0;
+  for (int i = 0 ; i < globals->symbolCount ; i++) {
+    Entry* entry = &globals->symbols[i];
+    /* An array element may be indexed by a variable, it is read from memory */
+    if (entry->key == NULL || kept[i] || entry->length != 1) continue;
+    /* A negative int is out of range too, its bits are those of a large number */
+    if (valueBits(entry->value) > MAX_IMM) continue;
+    entry->constant = true;
+    count++;
+  }
+  return count;
+}
+
+
+/* ==================================
+              LAYOUT
+=================================== */
+
+/* Bits holding the states of the largest enumeration */
+static uint32_t stateWidth(Table* globals) {
+  uint32_t width = 1;
+  for (int i = 0 ; i < globals->symbolCount ; i++) {
+    Entry* entry = &globals->symbols[i];
+    if (entry->key == NULL || !IS_STATE(entry->value)) continue;
+    while ((1u << width) < (uint32_t)AS_STATE(entry->value).stateNumber) width++;
+  }
+  return width;
+}
+
+
+/* First address from a given one where a field fits: a single value does not straddle a word and
+   the elements of an array (a power of two up to a word) are aligned on their width so none of them does */
+static uint32_t fitField(uint32_t address, uint32_t width, int length) {
+  if (length > 1) return (address + width - 1) / width * width;
+  if (address % LAYOUT_WORD + width > LAYOUT_WORD) return (address + LAYOUT_WORD - 1) / LAYOUT_WORD * LAYOUT_WORD;
+  return address;
+}
+
+
+/* Remember a hole left by the alignment, the oldest one is forgotten when there is no room */
+static void addGap(Gap* gaps, int* gapCount, uint32_t start, uint32_t end) {
+  if (end <= start) return;
+  if (*gapCount == LAYOUT_GAPS) {
+    for (int i = 1 ; i < LAYOUT_GAPS ; i++) gaps[i - 1] = gaps[i];
+    (*gapCount)--;
+  }
+  gaps[(*gapCount)++] = (Gap){start, end};
+}
+
+
+/* Address of a field, in the first hole it fits in or after the last field */
+static uint32_t placeField(Gap* gaps, int* gapCount, uint32_t* end, uint32_t width, int length) {
+  uint32_t size = width * length;
+  for (int i = 0 ; i < *gapCount ; i++) {
+    Gap gap = gaps[i];
+    uint32_t address = fitField(gap.start, width, length);
+    if (address + size > gap.end) continue;
+    /* The rest of the hole stays available on both sides */
+    for (int j = i + 1 ; j < *gapCount ; j++) gaps[j - 1] = gaps[j];
+    (*gapCount)--;
+    addGap(gaps, gapCount, gap.start, address);
+    addGap(gaps, gapCount, address + size, gap.end);
+    return address;
+  }
+  uint32_t address = fitField(*end, width, length);
+  addGap(gaps, gapCount, *end, address);
+  *end = address + size;
+  return address;
+}
+
+
+/* Lay the globals out again in a given order */
+void layoutGlobals(Table* globals, StateImage* image, AccessOrder* order, bool pack) {
+  StateImage* laid = initStateImage();
+  if (pack) {
+    laid->widths[typeCfg(VAL_BOOL)]  = PACKED_BOOL_SIZE;
+    laid->widths[typeCfg(VAL_BYTE)]  = PACKED_BYTE_SIZE;
+    laid->widths[typeCfg(VAL_INT)]   = PACKED_INT_SIZE;
+    laid->widths[typeCfg(VAL_STATE)] = stateWidth(globals);
+  } else {
+    memcpy(laid->widths, image->widths, TYPE_CODES);
+  }
+  if (order != NULL) endAccessOrder(order);
+  Gap gaps[LAYOUT_GAPS];
+  int gapCount = 0;
+  uint32_t end = 0;
+  for (int i = 0 ; i < globals->symbolCount ; i++) {
+    Entry* entry = &globals->symbols[order == NULL ? i : order->symbols[i]];
+    /* A declaration given again is not addressed anymore and a constant is not read, they take no room */
+    if (entry->key == NULL || entry->constant) continue;
+    uint32_t width = typeWidth(laid, entry->value.type);
+    uint32_t oldWidth = typeWidth(image, entry->value.type);
+    uint32_t address = placeField(gaps, &gapCount, &end, width, entry->length);
+    /* The values are in the range of their type, only their low bits are kept */
+    for (int e = 0 ; e < entry->length ; e++) {
+      setImageBits(laid, address + e * width, width, imageBits(image, entry->address + e * oldWidth, oldWidth));
+    }
+    entry->address = address;
+  }
+  sizeImage(laid, end);
+  globals->currentAddress = end;
+  /* The image takes the new content */
+  FREE(image->bytes);
+  *image = *laid;
+  FREE(laid);
+}
@@ -0,0 +1,56 @@
+#ifndef sdvu_layout_h
+#define sdvu_layout_h
+
+#include "common.h"
+#include "image.h"
+#include "table.h"
+
+/* ==================================
+        STRUCTS AND GLOBALS
+=================================== */
+
+/* Widths of the packed layout, each value takes the bits of its domain. An int keeps its 32 bits: any
+   of them may go negative through the arithmetic of the processes, and the core loads a narrower int
+   without extending its sign */
+#define PACKED_BOOL_SIZE 1
+#define PACKED_BYTE_SIZE 8
+#define PACKED_INT_SIZE  INT_SIZE
+/* Word of the state vector read at once, a value never straddles two of them */
+#define LAYOUT_WORD 32
+/* Number of holes left by the alignment remembered to place the next fields in */
+#define LAYOUT_GAPS 16
+
+/* Hole of the state vector, from its first bit to the one following its last */
+typedef struct {
+  uint32_t start;
+  uint32_t end;
+} Gap;
+
+/* Placement order of the globals, from the accesses of the processes: the globals named by each
+   process in turn, in the order they first appear, so the globals of a process are contiguous
+   (those of the processes before it aside) and the ones no process names come last */
+typedef struct {
+  int count;    /* Number of symbols placed */
+  int capacity; /* Number of symbols of the table */
+  int* symbols; /* Symbols in placement order */
+  bool* placed; /* Whether each symbol is placed, indexed by symbol */
+} AccessOrder;
+
+/* Allocation/Deallocation routine */
+AccessOrder* initAccessOrder(Table* globals);
+void freeAccessOrder(AccessOrder* order);
+/* Place a global named by a process if it is not yet */
+void accessGlobal(AccessOrder* order, int symbol);
+/* Place the globals no process named, the order then holds every symbol */
+void endAccessOrder(AccessOrder* order);
+
+/* Mark the globals no process writes nor indexes (flagged in kept, indexed by symbol) as constants when
+   they are single values whose initial value fits an immediate, returns the number of constants */
+int markConstants(Table* globals, bool* kept);
+
+/* Lay the globals out again in a given order (NULL for the order of their declarations), with the
+   packed widths if asked (a state takes the bits of the largest enumeration), the constants left out.
+   Their addresses, the size of the state vector and the image are updated. */
+void layoutGlobals(Table* globals, StateImage* image, AccessOrder* order, bool pack);
+
+#endif
@@ -0,0 +1,448 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "chunk.h"
+#include "compiler.h"
+#include "disassembler.h"
+#include "ir.h"
+#include "lower.h"
+#include "register.h"
+#include "sstring.h"
+
+/* ==================================
+        STRUCTS AND GLOBALS
+=================================== */
+
+/* Lowering state */
+typedef struct {
+  IrProcess* process; /* Process being lowered */
+  int current;        /* Index of the operation being lowered */
+  bool hadError;      /* An error was encountered */
+  IrOp* address;      /* Array access whose element address is in the address register (NULL if none) */
+  int* jumps;         /* Backpatch list, chunk index (+1) of each guard jump to the end of the process */
+  int jumpCount;      /* Number of guard jumps */
+  int jumpCapacity;   /* Size of the backpatch list */
+  Compiler* compiler; /* Compilation context, owner of the chunk and of the registers */
+} Lowerer;
+
+/* Notifies an error on the operation being lowered */
+static void error(Lowerer* lowerer, const char* message) {
+  if (lowerer->hadError) return;
+  int line = lowerer->process->ops[lowerer->current].line;
+  fprintf(stderr, "[line %d] Error: %s\n", line, message);
+  lowerer->hadError = true;
+}
+
+
+/* ==================================
+          CHUNK UTILITIES
+=================================== */
+
+/* Utility to increment the PC */
+static void incrementPC(Lowerer* lowerer) {
+  if (lowerer->compiler->pc == 0xFFFFFF) return;
+  lowerer->compiler->pc += 1;
+}
+
+
+/* Instruction of the process being lowered, released with the process arena */
+static Instruction* newInstruction(Lowerer* lowerer) {
+  return arenaInstruction(lowerer->process->arena);
+}
+
+
+/* Write an instruction to the chunk */
+static void emitInstruction(Lowerer* lowerer, uint32_t bitsInstruction) {
+  disassembleInstruction(lowerer->compiler->disassembler, bitsInstruction);
+  writeChunk(lowerer->compiler->chunk, bitsInstruction);
+  incrementPC(lowerer);
+}
+
+
+/* ==================================
+         REGISTER ALLOCATION
+=================================== */
+
+/* Index of the next operation reading a variable after the current one (-1 if none) */
+static int nextUse(Lowerer* lowerer, int symbol) {
+  for (int i = lowerer->current + 1 ; i < lowerer->process->count ; i++) {
+    if (readsVariable(&lowerer->process->ops[i], symbol)) return i;
+  }
+  return -1;
+}
+
+
+/* Check if a register holds a temporary variable */
+static bool holdsTemp(Register* reg) {
+  return reg->varName != NULL && IS_NIL(reg->varValue);
+}
+
+
+/* Write a global back to memory before its register is reused, only if it was modified */
+static void spillGlob(Lowerer* lowerer, Register* reg) {
+  if (!reg->isDirty) return;
+  emitInstruction(lowerer, storeFromRegister(reg));
+  reg->isDirty = false;
+}
+
+
+/* Look for the register containing a given variable (NULL otherwise) */
+static Register* getRegFromVar(Lowerer* lowerer, int symbol) {
+  int number = lowerer->compiler->location[symbol];
+  return number == -1 ? NULL : &lowerer->compiler->registers[number];
+}
+
+
+/* Record the variable held by a register */
+static void bindRegister(Lowerer* lowerer, Register* reg, Operand* operand) {
+  reg->varName = operand->name;
+  reg->symbol = operand->symbol;
+  lowerer->compiler->location[operand->symbol] = reg->number;
+}
+
+
+/* Empty a register, its variable is back in memory (or dead) */
+static void evictRegister(Lowerer* lowerer, Register* reg) {
+  if (reg->symbol != -1) lowerer->compiler->location[reg->symbol] = -1;
+  emptyRegister(reg);
+}
+
+
+/* Find a register to hold a new value. Free registers are used first, then the global
+   whose next use is the farthest is evicted (Belady), preferring clean registers as they
+   do not need a store. Temporaries cannot be spilled as they have no memory location. */
+static Register* allocateRegister(Lowerer* lowerer) {
+  Register* victim = NULL;
+  int victimDistance = -1;
+  for (int i = 0 ; i < REG_NUMBER ; i++) {
+    Register* reg = &lowerer->compiler->registers[i];
+    if (reg->isLocked) continue;
+    /* Free register */
+    if (reg->varName == NULL) {
+      victim = reg;
+      break;
+    }
+    if (holdsTemp(reg)) continue;
+    /* Global candidate, a global not used anymore is the best candidate */
+    int use = nextUse(lowerer, reg->symbol);
+    int distance = (use == -1) ? INT32_MAX : use - lowerer->current;
+    bool better = (distance > victimDistance) ||
+                  (distance == victimDistance && victim->isDirty && !reg->isDirty);
+    if (better) {
+      victim = reg;
+      victimDistance = distance;
+    }
+  }
+  if (victim == NULL) {
+    error(lowerer, "Not enough registers to hold temporary variables.");
+    victim = &lowerer->compiler->registers[0];
+  }
+  /* Evict the previous variable */
+  spillGlob(lowerer, victim);
+  evictRegister(lowerer, victim);
+  victim->isLocked = true;
+  return victim;
+}
+
+
+/* Bind a temporary variable to a new register */
+static Register* bindTemp(Lowerer* lowerer, Operand* operand) {
+  Register* reg = allocateRegister(lowerer);
+  bindRegister(lowerer, reg, operand);
+  return reg;
+}
+
+
+/* Resolve a temporary variable that should already be in a register */
+static Register* tempRegister(Lowerer* lowerer, Operand* operand) {
+  Register* reg = getRegFromVar(lowerer, operand->symbol);
+  if (reg == NULL) {
+    error(lowerer, "Temporary variable should be defined before use.");
+    return &lowerer->compiler->registers[0];
+  }
+  reg->isLocked = true;
+  return reg;
+}
+
+
+/* Resolve a global variable, loading it from memory if needed and asked for */
+static Register* globRegister(Lowerer* lowerer, Operand* operand, bool load) {
+  Register* reg = getRegFromVar(lowerer, operand->symbol);
+  if (reg == NULL) {
+    reg = allocateRegister(lowerer);
+    Value value = NIL_VAL;
+    value.type = operand->valueType;
+    loadVariable(reg, operand->name, value, operand->address);
+    bindRegister(lowerer, reg, operand);
+    if (load) {
+      /* Emit a load with the variable to use */
+      emitInstruction(lowerer, loadFromRegister(reg));
+    }
+  }
+  reg->isLocked = true;
+  return reg;
+}
+
+
+/* Resolve a variable read by the current operation */
+static Register* readOperand(Lowerer* lowerer, Operand* operand) {
+  if (operand->type == OPERAND_TEMP) return tempRegister(lowerer, operand);
+  return globRegister(lowerer, operand, true);
+}
+
+
+/* Unlock the operands of the emitted instructions and free the temporaries that are not used anymore */
+static void releaseRegisters(Lowerer* lowerer) {
+  for (int i = 0 ; i < REG_NUMBER ; i++) {
+    Register* reg = &lowerer->compiler->registers[i];
+    reg->isLocked = false;
+    if (holdsTemp(reg) && nextUse(lowerer, reg->symbol) == -1) {
+      evictRegister(lowerer, reg);
+    }
+  }
+}
+
+
+/* Resolve the destination of the current operation. Operands are read before the
+   destination is written so the registers of dead operands can be reused. */
+static Register* writeDestination(Lowerer* lowerer, Operand* operand) {
+  releaseRegisters(lowerer);
+  if (operand->type == OPERAND_TEMP) return bindTemp(lowerer, operand);
+  /* The address computed from the previous value of an index is outdated */
+  if (lowerer->address != NULL && operandsEqual(lowerer->address->a, *operand)) lowerer->address = NULL;
+  /* The previous value is overwritten so it does not need to be loaded */
+  Register* reg = globRegister(lowerer, operand, false);
+  reg->isDirty = true;
+  return reg;
+}
+
+
+/* ==================================
+        OPERATIONS LOWERING
+=================================== */
+
+/* Write a NOT on the result if the operation is negated */
+static void lowerNegation(Lowerer* lowerer, IrOp* op, Register* rd) {
+  if (!op->negated) return;
+  Instruction* notInstr = newInstruction(lowerer);
+  emitInstruction(lowerer, notInstruction(notInstr, rd->number));
+}
+
+
+/* dst = a (LOAD_IMM or LOAD_REG) */
+static void lowerAssign(Lowerer* lowerer, IrOp* op) {
+  Instruction* instruction = newInstruction(lowerer);
+  if (op->a.type == OPERAND_IMM) {
+    Register* rd = writeDestination(lowerer, &op->dst);
+    emitInstruction(lowerer, loadInstructionImm(instruction, rd->number, op->a.imm));
+    lowerNegation(lowerer, op, rd);
+  } else {
+    Register* ra = readOperand(lowerer, &op->a);
+    Register* rd = writeDestination(lowerer, &op->dst);
+    emitInstruction(lowerer, loadInstructionReg(instruction, rd->number, ra->number));
+    lowerNegation(lowerer, op, rd);
+  }
+}
+
+
+/* dst = a op b */
+static void lowerBinary(Lowerer* lowerer, IrOp* op) {
+  Instruction* instruction = newInstruction(lowerer);
+  instruction->op_code = op->op_code;
+  /* Set the configuration bit of each immediate operand (LHS - second, RHS - first) */
+  unsigned int cfg_mask = 0;
+  if (op->a.type == OPERAND_IMM) {
+    instruction->imma = op->a.imm;
+    cfg_mask |= 0b1 << 1;
+  } else {
+    instruction->ra = readOperand(lowerer, &op->a)->number;
+  }
+  if (op->b.type == OPERAND_IMM) {
+    instruction->immb = op->b.imm;
+    cfg_mask |= 0b1;
+  } else {
+    instruction->rb = readOperand(lowerer, &op->b)->number;
+  }
+  instruction->cfg_mask = cfg_mask;
+  Register* rd = writeDestination(lowerer, &op->dst);
+  instruction->rd = rd->number;
+  emitInstruction(lowerer, instructionToUint32(instruction));
+  lowerNegation(lowerer, op, rd);
+}
+
+
+/* Compute the address of an array element in a register: rd = size * index ; rd = base + rd.
+   A base too large for an immediate is split as q * MAX_IMM + r, the product built in a scratch register */
+static void lowerAddress(Lowerer* lowerer, IrOp* op, Register* indexReg, Register* rd) {
+  /* Process Mul Operation */
+  Instruction* offsetMulInstruction = newInstruction(lowerer);
+  binaryInstructionIR(offsetMulInstruction, OP_MUL, rd->number, op->elemSize, indexReg->number);
+  emitInstruction(lowerer, instructionToUint32(offsetMulInstruction));
+  uint32_t base = op->base;
+  if (base > MAX_IMM) {
+    Register* scratch = allocateRegister(lowerer);
+    Instruction* baseMulInstruction = newInstruction(lowerer);
+    emitInstruction(lowerer, binaryInstructionII(baseMulInstruction, OP_MUL, scratch->number, base / MAX_IMM, MAX_IMM));
+    Instruction* baseAddInstruction = newInstruction(lowerer);
+    emitInstruction(lowerer, binaryInstructionRR(baseAddInstruction, OP_ADD, rd->number, scratch->number, rd->number));
+    base %= MAX_IMM;
+    if (base == 0) return;
+  }
+  /* Process ADD operation */
+  Instruction* addAddressInstruction = newInstruction(lowerer);
+  emitInstruction(lowerer, binaryInstructionIR(addAddressInstruction, OP_ADD, rd->number, base, rd->number));
+}
+
+
+/* Absolute address of an array element accessed with an immediate index */
+static uint32_t elementAddress(IrOp* op) {
+  return op->base + op->a.imm * op->elemSize;
+}
+
+
+/* Put the address of an array element in the address register, unless it is already there */
+static void addressToRegister(Lowerer* lowerer, IrOp* op) {
+  IrOp* held = lowerer->address;
+  if (held != NULL && held->arraySymbol == op->arraySymbol && operandsEqual(held->a, op->a)) return;
+  lowerAddress(lowerer, op, readOperand(lowerer, &op->a), lowerer->compiler->addressRegister);
+  lowerer->address = op;
+  lowerer->compiler->addressRegister->varName = op->array;
+}
+
+
+/* dst = array[a] */
+static void lowerLoadElem(Lowerer* lowerer, IrOp* op) {
+  if (op->a.type == OPERAND_IMM) {
+    /* The address is known at compile time, load it directly */
+    Register* rd = writeDestination(lowerer, &op->dst);
+    Instruction* loadAddrInstruction = newInstruction(lowerer);
+    emitInstruction(lowerer, loadInstructionAddr(loadAddrInstruction, rd->number, elementAddress(op), typeCfg(op->elemType)));
+    return;
+  }
+  addressToRegister(lowerer, op);
+  Register* rd = writeDestination(lowerer, &op->dst);
+  Instruction* loadValueInstruction = newInstruction(lowerer);
+  emitInstruction(lowerer, loadInstructionRegAsAddr(loadValueInstruction, rd->number, lowerer->compiler->addressRegister->number, typeCfg(op->elemType)));
+}
+
+
+/* array[a] = b */
+static void lowerStoreElem(Lowerer* lowerer, IrOp* op) {
+  /* Resolve the value to store */
+  Register* valueReg;
+  if (op->b.type == OPERAND_IMM) {
+    valueReg = allocateRegister(lowerer);
+    Instruction* loadImmInstruction = newInstruction(lowerer);
+    emitInstruction(lowerer, loadInstructionImm(loadImmInstruction, valueReg->number, op->b.imm));
+  } else {
+    valueReg = readOperand(lowerer, &op->b);
+  }
+  if (op->a.type == OPERAND_IMM) {
+    /* The address is known at compile time, store to it directly */
+    Instruction* storeAddrInstruction = newInstruction(lowerer);
+    emitInstruction(lowerer, storeInstruction(storeAddrInstruction, valueReg->number, elementAddress(op), typeCfg(op->elemType)));
+    return;
+  }
+  /* The address goes to the special address register */
+  addressToRegister(lowerer, op);
+  /* Write Store for the array element */
+  Instruction* storeInstruction = newInstruction(lowerer);
+  storeInstruction->op_code = OP_STORE;
+  storeInstruction->rd = valueReg->number;
+  storeInstruction->ra = lowerer->compiler->addressRegister->number;
+  storeInstruction->cfg_mask = STORE_RAA;
+  storeInstruction->type = typeCfg(op->elemType);
+  emitInstruction(lowerer, instructionToUint32(storeInstruction));
+}
+
+
+/* Jump to the end of the process if the guard is false, the jump is added to the backpatch list */
+static void lowerGuard(Lowerer* lowerer, IrOp* op) {
+  Register* condReg;
+  if (op->a.type == OPERAND_IMM) {
+    /* The condition is a constant, the jump still needs it in a register */
+    condReg = allocateRegister(lowerer);
+    Instruction* loadImmInstruction = newInstruction(lowerer);
+    emitInstruction(lowerer, loadInstructionImm(loadImmInstruction, condReg->number, op->a.imm));
+  } else {
+    condReg = readOperand(lowerer, &op->a);
+  }
+  /* Globals written before the jump have to reach memory even if the effect is skipped */
+  for (int i = 0 ; i < REG_NUMBER ; i++) {
+    spillGlob(lowerer, &lowerer->compiler->registers[i]);
+  }
+  /* Emit a JMP with a placeholder */
+  Instruction* jmpInstr = newInstruction(lowerer);
+  emitInstruction(lowerer, jumpInstruction(jmpInstr, condReg->number, 0x000000));
+  if (lowerer->jumpCapacity < lowerer->jumpCount + 1) {
+    int oldCapacity = lowerer->jumpCapacity;
+    lowerer->jumpCapacity = GROW_CAPACITY(oldCapacity);
+    lowerer->jumps = GROW_ARRAY(int, lowerer->jumps, lowerer->jumpCapacity);
+  }
+  lowerer->jumps[lowerer->jumpCount++] = lowerer->compiler->chunk->count;
+}
+
+
+/* ==================================
+          LOWERING ROUTINE
+=================================== */
+
+bool lowerProcess(Compiler* compiler, IrProcess* process) {
+  Lowerer context;
+  Lowerer* lowerer = &context;
+  lowerer->compiler = compiler;
+  lowerer->process = process;
+  lowerer->hadError = false;
+  lowerer->address = NULL;
+  lowerer->jumps = NULL;
+  lowerer->jumpCount = 0;
+  lowerer->jumpCapacity = 0;
+  /* Every variable starts in memory, the locations are cleared again when the registers are emptied */
+  int symbols = symbolCount(process);
+  if (compiler->locationCapacity < symbols) {
+    int oldCapacity = compiler->locationCapacity;
+    compiler->locationCapacity = GROW_CAPACITY(symbols);
+    compiler->location = GROW_ARRAY(int, compiler->location, compiler->locationCapacity);
+    for (int i = oldCapacity ; i < compiler->locationCapacity ; i++) {
+      compiler->location[i] = -1;
+    }
+  }
+
+  for (lowerer->current = 0 ; lowerer->current < process->count ; lowerer->current++) {
+    IrOp* op = &process->ops[lowerer->current];
+    switch (op->type) {
+      case IR_ASSIGN:     lowerAssign(lowerer, op); break;
+      case IR_BINARY:     lowerBinary(lowerer, op); break;
+      case IR_LOAD_ELEM:  lowerLoadElem(lowerer, op); break;
+      case IR_STORE_ELEM: lowerStoreElem(lowerer, op); break;
+      case IR_GUARD:      lowerGuard(lowerer, op); break;
+      case IR_NOP:        break;
+    }
+    releaseRegisters(lowerer);
+    showRegisterState(lowerer->compiler->disassembler, lowerer->compiler->registers, lowerer->compiler->addressRegister);
+  }
+
+  /* Emit the different stores for the modified global variables */
+  for (int i = 0 ; i < REG_NUMBER ; i++) {
+    spillGlob(lowerer, &lowerer->compiler->registers[i]);
+  }
+
+  /* Emit a reset jump instruction */
+  Instruction* endGA = newInstruction(lowerer);
+  emitInstruction(lowerer, endGAInstruction(endGA));
+  /* Patch the jumps from the guard conditions */
+  for (int i = 0 ; i < lowerer->jumpCount ; i++) {
+    int jmpSrc = lowerer->jumps[i];
+    uint32_t oldInstr = lowerer->compiler->chunk->instructions[jmpSrc-1];
+    if (lowerer->compiler->disassembler->verbose) fprintf(lowerer->compiler->disassembler->outstream, "Backpatching Jump from: %d\n", jmpSrc);
+    lowerer->compiler->chunk->instructions[jmpSrc-1] = (oldInstr & 0xFF000000) | (lowerer->compiler->pc);
+  }
+  FREE(lowerer->jumps);
+  /* Registers do not carry values over to the next process */
+  for (int i = 0 ; i < REG_NUMBER ; i++) {
+    evictRegister(lowerer, &lowerer->compiler->registers[i]);
+  }
+  emptyRegister(lowerer->compiler->addressRegister);
+  return !lowerer->hadError;
+}
@@ -0,0 +1,11 @@
+#ifndef sdvu_lower_h
+#define sdvu_lower_h
+
+#include "common.h"
+#include "compiler.h"
+#include "ir.h"
+
+/* Lower the IR of a process to instructions in the compiler chunk (register assignment and encoding) */
+bool lowerProcess(Compiler* compiler, IrProcess* process);
+
+#endif
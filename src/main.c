@@ -1,9 +1,19 @@
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "compiler.h"
+#include "image.h"
+#include "object.h"
+#include "partition.h"
 #include "scanner.h"
+#include "source.h"
+
+/* Maximum number of target counts compiled in one run */
+#define MAX_TARGET_COUNTS 16
 
 FILE* logOutstream;
 char* binName;
@@ -12,110 +22,157 @@ char* binName;
           EXECUTION METHODS
 ====================================*/
 
-/* File handling
-============= */
-
-/* Read a file and return the contents in a buffer */
-static char* readFile(const char* path) {
-  /* Open the file */
-  FILE* file = fopen(path, "rb");
-  if (file == NULL) {
-    fprintf(stderr, "Could not open file \"%s\".\n", path);
-    exit(74);
-  }
-
-  /* Look for the end of the file */
-  fseek(file, 0L, SEEK_END);
-  /* Number of bytes since the start of the file */
-  size_t fileSize = ftell(file);
-  /* Return to the beginning */
-  rewind(file);
-
-  /* Allocate enough memory to store the content of the file */
-  char* buffer = (char*)malloc(fileSize + 1);
-  if (buffer == NULL) {
-    fprintf(stderr, "Not enough memory to read \"%s\".\n", path);
-    exit(74);
-  }
-
-  /* Read the bytes from the content of the file */
-  size_t bytesRead = fread(buffer, sizeof(char), fileSize, file);
-  if (bytesRead < fileSize) {
-    fprintf(stderr, "Could not read file \"%s\".\n", path);
-    exit(74);
-  }
-
-  buffer[bytesRead] = '\0';
-  fclose(file);
-  return buffer;
-}
-
 /* Actions
 ======= */
 
-int countOccurencesInString(char* source, char* word) {
-  int stringLen = strlen(source); // length of string
-  int searchLen = strlen(word);   // length of word to be searched
-  int count = 0;
-  int found = 1;
-  for(int i=0 ; i <= stringLen-searchLen ; i++) {
-    /* Match word with string */
-    found = 1;
-    for(int j=0 ; j < searchLen ; j++) {
-      if(source[i + j] != word[j]) {
-        found = 0;
-        break;
-      }
-    }
-    if(found == 1) {
-      count++;
-    }
-  }
-  return count;
-}
-
 /* Scan a given file */
 static void scanFile(const char* path, FILE* outstream) {
-  char* source = readFile(path);
-  initScanner(source);
+  Source source = readFile(path);
+  Scanner scanner;
+  initScanner(&scanner, source.chars);
   Token token;
   for (;;) {
-    token = scanToken();
+    token = scanToken(&scanner);
     fprintToken(outstream, token);
     if (token.type == TOKEN_EOF) {
       fprintf(outstream, "File scanned\n");
       break;
     }
   }
-  free(source);
+  freeSource(&source);
 }
 
-/* Compiler a given file */
-static void compileFile(const char* path, int nbTargets, bool verbose) {
-  /* Read file */
-  char* source = readFile(path);
-  /* Count number of guard/actions if needed */
-  int nbGA = 0;
-  nbGA = countOccurencesInString(source, "process");
+/* Seconds elapsed since a given time */
+static double elapsedSince(struct timespec* start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+
+/* Measure the throughput of the scanner on a given file, scanned again for at least a second */
+static void benchFile(const char* path, FILE* outstream) {
+  Source source = readFile(path);
+  size_t tokens = 0;
+  int passes = 0;
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  double seconds;
+  do {
+    Scanner scanner;
+    initScanner(&scanner, source.chars);
+    tokens = 0;
+    while (scanToken(&scanner).type != TOKEN_EOF) tokens++;
+    passes++;
+    seconds = elapsedSince(&start);
+  } while (seconds < 1.0);
+  fprintf(outstream, "%zu bytes, %zu tokens, %d passes, %.1f MB/s\n",
+          source.length, tokens, passes, source.length * (double)passes / seconds / 1e6);
+  freeSource(&source);
+}
+
+
+/* Prefix of the binaries of a target count, several counts write their binaries next to each other */
+static char* countBinName(char* buffer, char* binPrefix, int count, int countNumber) {
+  if (countNumber == 1) return binPrefix;
+  snprintf(buffer, 256, "%s-%d", binPrefix, count);
+  return buffer;
+}
+
+
+/* Compile a given file for each target count, the source is tokenized once when asked for
+   or when the tokens are reused by several counts. A streamed compilation keeps neither the
+   tokens nor the processes. */
+static void compileFile(const char* path, CompileOptions* options, int* targetCounts, int countNumber,
+                        bool tokenize, bool stream, bool verbose) {
+  /* Map file */
+  Source source = readFile(path);
+  /* Offsets in the token buffer are 32-bit */
+  TokenBuffer* tokens = NULL;
+  if (!stream && (tokenize || countNumber > 1) && source.length <= UINT32_MAX) tokens = tokenizeSource(source.chars);
+  /* Find the processes in one scan, the compilation and partitioning are sized from it */
+  ProcessIndex* processes = NULL;
+  if (!stream) processes = tokens != NULL ? indexTokenProcesses(tokens) : indexProcesses(source.chars);
   /* Setup disassembler */
-  initDisassembler(verbose, logOutstream);
-  /* Setup compiler */
-  initCompiler();
-  compile(source, nbTargets, nbGA, binName);
+  Disassembler* disassembler = initDisassembler(verbose, logOutstream);
+  char* binPrefix = options->binName;
+  for (int i = 0 ; i < countNumber ; i++) {
+    char binName[256];
+    options->binName = countBinName(binName, binPrefix, targetCounts[i], countNumber);
+    options->nbTargets = targetCounts[i];
+    /* Setup compiler */
+    Compiler* compiler = initCompiler(disassembler);
+    if (stream) {
+      compileStream(compiler, &source, options);
+    } else {
+      compile(compiler, source.chars, tokens, processes, options);
+    }
+    freeCompiler(compiler);
+  }
+  options->binName = binPrefix;
   /* Free resources */
-  freeCompiler();
-  freeDisassembler();
-  free(source);
+  freeDisassembler(disassembler);
+  if (processes != NULL) freeProcessIndex(processes);
+  if (tokens != NULL) freeTokenBuffer(tokens);
+  freeSource(&source);
+}
+
+
+/* Link objects into the binaries of each target count, the objects are read once */
+static void linkFiles(char** paths, int pathCount, CompileOptions* options, int* targetCounts, int countNumber,
+                      bool verbose) {
+  Partition* partition = initPartition(0);
+  StateImage* image = NULL;
+  for (int i = 0 ; i < pathCount ; i++) {
+    StateImage* objectImage = initStateImage();
+    if (!readObject(partition, objectImage, paths[i])) {
+      fprintf(stderr, "Could not read object \"%s\".\n", paths[i]);
+      exit(74);
+    }
+    /* The processes of the objects must address the same state vector */
+    if (image == NULL) {
+      image = objectImage;
+      continue;
+    }
+    if (objectImage->size != image->size || memcmp(objectImage->widths, image->widths, TYPE_CODES) != 0 ||
+        memcmp(objectImage->bytes, image->bytes, imageLength(image)) != 0) {
+      fprintf(stderr, "Object \"%s\" was compiled from other globals.\n", paths[i]);
+      exit(65);
+    }
+    freeStateImage(objectImage);
+  }
+  Disassembler* disassembler = initDisassembler(verbose, logOutstream);
+  char* binPrefix = options->binName;
+  for (int i = 0 ; i < countNumber ; i++) {
+    char binName[256];
+    options->binName = countBinName(binName, binPrefix, targetCounts[i], countNumber);
+    options->nbTargets = targetCounts[i];
+    linkPartition(disassembler, partition, image, options);
+  }
+  options->binName = binPrefix;
+  freeDisassembler(disassembler);
+  freePartition(partition);
+  freeStateImage(image);
+}
+
+
+/* Parse a comma separated list of target counts, returns the number of counts */
+static int parseTargetCounts(char* list, int* targetCounts, int max) {
+  int countNumber = 0;
+  for (char* count = strtok(list, ",") ; count != NULL && countNumber < max ; count = strtok(NULL, ",")) {
+    targetCounts[countNumber++] = atoi(count);
+  }
+  return countNumber;
 }
 
 /* Disassemble a given file */
 static void disassembleFile(const char* path, bool verbose) {
   /* Setup disassembler */
-  initDisassembler(verbose, logOutstream);
+  Disassembler* disassembler = initDisassembler(verbose, logOutstream);
   /* Disassemble binary file */
-  disassembleBinary(path);
+  disassembleBinary(disassembler, path);
   /* Free resources */
-  freeDisassembler();
+  freeDisassembler(disassembler);
 }
 
 /* ==================================
@@ -129,8 +186,18 @@ int main(int argc, char *argv[]) {
   char* compileTarget = NULL;
   char* disassembleTarget = NULL;
   char* scanTarget = NULL;
-  /* Number of CPUs */
-  int nbTargets = 1;
+  char* benchTarget = NULL;
+  /* Number of CPUs, several counts can be compiled from the same tokens */
+  int targetCounts[MAX_TARGET_COUNTS] = {1};
+  int countNumber = 1;
+  /* Tokenize the whole source before parsing */
+  bool tokenize = false;
+  /* Write each process as soon as it is compiled, in a bounded memory */
+  bool stream = false;
+  /* Distribution of the processes over the targets */
+  PartitionMode partitionMode = PARTITION_COUNT;
+  /* Number of threads compiling the processes */
+  int jobs = 1;
   /* Name of the resulting binary */
   binName = "a.out";
   /* Default output stream */
@@ -142,12 +209,31 @@ int main(int argc, char *argv[]) {
     COMPILE_MODE,
     DISASSEMBLE_MODE,
     SCAN_MODE,
+    BENCH_MODE,
+    LINK_MODE,
     COUNT_MODE
   } mode = ERROR_MODE;
+  /* Write a relocatable object instead of the binaries */
+  bool object = false;
+  /* Layout of the binaries */
+  OutputFormat format = OUTPUT_RAW;
+  /* Size each global to its domain in the state vector */
+  bool pack = false;
+  /* Lay the globals out in the order the processes access them */
+  bool reorder = false;
+  /* Read the globals no process writes as immediates */
+  bool inlineConstants = false;
+
+  /* The link mode is given as a command, followed by the options then the objects */
+  size_t firstOption = 1;
+  if (argc > 1 && strcmp(argv[1], "link") == 0) {
+    mode = LINK_MODE;
+    firstOption = 2;
+  }
 
   /* Parsing arguments */
   size_t optind;
-  for (optind = 1; optind < argc && argv[optind][0] == '-'; optind++) {
+  for (optind = firstOption; optind < argc && argv[optind][0] == '-'; optind++) {
     switch (argv[optind][1]) {
     case 'c': {
       mode = COMPILE_MODE;
@@ -169,11 +255,42 @@ int main(int argc, char *argv[]) {
       optind++;
       break;
     }
+    case 'b': {
+      mode = BENCH_MODE;
+      benchTarget = argv[optind + 1];
+      optind++;
+      break;
+    }
     case 'n': {
-      nbTargets = atoi(argv[optind + 1]);
+      countNumber = parseTargetCounts(argv[optind + 1], targetCounts, MAX_TARGET_COUNTS);
+      if (countNumber == 0) {
+        fprintf(stderr, "Expecting a list of target counts such as 2,4,8.\n");
+        exit(64);
+      }
       optind ++;
       break;
     }
+    case 'p': {
+      if (!parsePartitionMode(argv[optind + 1], &partitionMode)) {
+        fprintf(stderr, "Unknown partition mode \"%s\", expecting count, cost or affinity.\n", argv[optind + 1]);
+        exit(64);
+      }
+      optind++;
+      break;
+    }
+    case 'f': {
+      if (!parseOutputFormat(argv[optind + 1], &format)) {
+        fprintf(stderr, "Unknown output format \"%s\", expecting raw or container.\n", argv[optind + 1]);
+        exit(64);
+      }
+      optind++;
+      break;
+    }
+    case 'j': {
+      jobs = atoi(argv[optind + 1]);
+      optind++;
+      break;
+    }
     case 'l': {
       logOutstream = fopen(argv[optind + 1], "a");
       optind++;
@@ -184,20 +301,65 @@ int main(int argc, char *argv[]) {
       optind++;
       break;
     }
+    case '-': {
+      /* Long options */
+      if (strcmp(argv[optind], "--pack") == 0) {
+        pack = true;
+        break;
+      }
+      if (strcmp(argv[optind], "--reorder") == 0) {
+        reorder = true;
+        break;
+      }
+      if (strcmp(argv[optind], "--inline") == 0) {
+        inlineConstants = true;
+        break;
+      }
+      fprintf(stderr, "Unknown option \"%s\".\n", argv[optind]);
+      exit(64);
+    }
+    case 'm': stream = true; break;
+    case 'r': object = true; break;
+    case 't': tokenize = true; break;
     case 'v': verbose = true; break;
     default:
-      fprintf(stderr, "Usage: %s [-cdlosv] [file...]\n", argv[0]);
+      fprintf(stderr, "Usage: %s [-bcdfjlmnoprstv] [--pack] [--reorder] [--inline] [file...]\n", argv[0]);
       exit(64);
     }
   }
 
   /* Using arguments */
   switch (mode) {
-    case COMPILE_MODE:     compileFile(compileTarget, nbTargets, verbose); break;
+    case COMPILE_MODE: {
+      CompileOptions options = {targetCounts[0], partitionMode, jobs, binName, object, format, pack, reorder, inlineConstants};
+      /* An object does not depend on the targets, it is written once and not streamed */
+      if (object) {
+        countNumber = 1;
+        stream = false;
+      }
+      /* The sections of a container are contiguous, the processes of a target can not be appended */
+      if (stream && format == OUTPUT_CONTAINER) {
+        fprintf(stderr, "The container format can not be streamed, remove -m.\n");
+        exit(64);
+      }
+      compileFile(compileTarget, &options, targetCounts, countNumber, tokenize, stream, verbose);
+      break;
+    }
+    case LINK_MODE: {
+      if (optind >= argc) {
+        fprintf(stderr, "Usage: %s link [-flnopv] object...\n", argv[0]);
+        exit(64);
+      }
+      /* The layout of the state vector is the one the objects were compiled with */
+      CompileOptions options = {targetCounts[0], partitionMode, jobs, binName, false, format, false, false, false};
+      linkFiles(argv + optind, argc - optind, &options, targetCounts, countNumber, verbose);
+      break;
+    }
     case DISASSEMBLE_MODE: disassembleFile(disassembleTarget, verbose); break;
     case SCAN_MODE:        scanFile(scanTarget, logOutstream); break;
+    case BENCH_MODE:       benchFile(benchTarget, logOutstream); break;
     case ERROR_MODE: {
-      fprintf(stderr, "Usage: %s [-cds] [file...]\n", argv[0]);
+      fprintf(stderr, "Usage: %s [-bcds] [file...] or %s link [options] object...\n", argv[0], argv[0]);
       exit(64);
       break;
     }
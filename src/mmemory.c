@@ -19,3 +19,72 @@ void* reallocate(void* pointer, size_t newSize) {
   if (result == NULL) exit(1);
   return result;
 }
+
+
+/* ======================
+         ARENA
+====================== */
+
+/* Default size of a block, enough for the names and instructions of most processes */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+/* Alignment of the allocations */
+#define ARENA_ALIGNMENT 16
+/* Size of the header of a block, rounded up to keep the first bytes aligned */
+#define ARENA_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+/* Allocate a block holding at least a given number of bytes */
+static ArenaBlock* newBlock(size_t capacity, ArenaBlock* next) {
+  ArenaBlock* block = (ArenaBlock*)reallocate(NULL, ARENA_HEADER + capacity);
+  block->next = next;
+  block->capacity = capacity;
+  block->used = 0;
+  return block;
+}
+
+/* Arena initialization, the first block is allocated on the first request */
+Arena* initArena() {
+  Arena* arena = ALLOCATE_OBJ(Arena);
+  arena->current = NULL;
+  return arena;
+}
+
+/* Free the arena and all its blocks */
+void freeArena(Arena* arena) {
+  ArenaBlock* block = arena->current;
+  while (block != NULL) {
+    ArenaBlock* next = block->next;
+    FREE(block);
+    block = next;
+  }
+  FREE(arena);
+}
+
+/* Bump allocation in the current block, a new block is chained when it is full */
+void* arenaAllocate(Arena* arena, size_t size) {
+  size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+  ArenaBlock* block = arena->current;
+  if (block == NULL || block->capacity - block->used < size) {
+    size_t capacity = ARENA_BLOCK_SIZE;
+    if (block != NULL && block->capacity * 2 > capacity) capacity = block->capacity * 2;
+    if (size > capacity) capacity = size;
+    block = newBlock(capacity, block);
+    arena->current = block;
+  }
+  void* result = (char*)block + ARENA_HEADER + block->used;
+  block->used += size;
+  return result;
+}
+
+/* Release every allocation, only the last (largest) block is kept */
+void resetArena(Arena* arena) {
+  ArenaBlock* block = arena->current;
+  if (block == NULL) return;
+  ArenaBlock* previous = block->next;
+  while (previous != NULL) {
+    ArenaBlock* next = previous->next;
+    FREE(previous);
+    previous = next;
+  }
+  block->next = NULL;
+  block->used = 0;
+}
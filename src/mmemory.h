@@ -36,4 +36,37 @@ changes the size of allocated chunks. It knows what operation is going on throug
 */
 void* reallocate(void* pointer, size_t newSize);
 
+
+/* ======================
+         ARENA
+====================== */
+
+/* Block of memory handed out by an arena, its bytes follow the header */
+typedef struct ArenaBlock {
+  struct ArenaBlock* next; /* Block filled before this one */
+  size_t capacity;         /* Number of usable bytes */
+  size_t used;             /* Number of bytes handed out */
+} ArenaBlock;
+
+/* Bump allocator for short-lived objects, released all at once */
+typedef struct {
+  ArenaBlock* current; /* Block being filled, the previous ones are chained behind */
+} Arena;
+
+/* Allocate an object of a given type in an arena */
+#define ARENA_OBJ(arena, type) \
+    (type*)arenaAllocate(arena, sizeof(type))
+
+/* Allocate an array with a given element type and count in an arena */
+#define ARENA_ARRAY(arena, type, count) \
+    (type*)arenaAllocate(arena, sizeof(type) * (count))
+
+/* Allocation/Deallocation routine */
+Arena* initArena();
+void freeArena(Arena* arena);
+/* Allocate a block of a given size, it stays valid until the arena is reset */
+void* arenaAllocate(Arena* arena, size_t size);
+/* Release every allocation at once, the largest block is kept for reuse */
+void resetArena(Arena* arena);
+
 #endif
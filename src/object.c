@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "chunk.h"
+#include "image.h"
+#include "mmemory.h"
+#include "object.h"
+#include "partition.h"
+
+/* ==================================
+              WRITING
+=================================== */
+
+/* Write a sequence of words */
+static bool writeWords(FILE* file, const uint32_t* words, size_t count) {
+  return fwrite(words, sizeof(uint32_t), count, file) == count;
+}
+
+
+/* Write the code, relocations and accesses of a process */
+static bool writeProcess(FILE* file, ProcessCode* process) {
+  uint32_t header[4] = {process->chunk->count, process->relocationCount, process->accessCount, process->cycles};
+  bool written = writeWords(file, header, 4);
+  written &= writeWords(file, process->chunk->instructions, process->chunk->count);
+  written &= writeWords(file, process->relocations, process->relocationCount);
+  for (int i = 0 ; i < process->accessCount ; i++) {
+    uint32_t access[2] = {process->accesses[i].address, process->accesses[i].written};
+    written &= writeWords(file, access, 2);
+  }
+  return written;
+}
+
+
+/* Number of words holding an image */
+static uint32_t imageWords(StateImage* image) {
+  return (imageLength(image) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+}
+
+
+/* Write the processes of a partition */
+bool writeObject(Partition* partition, StateImage* image, const char* path) {
+  FILE* file = fopen(path, "wb");
+  if (file == NULL) return false;
+  uint32_t header[5] = {OBJECT_MAGIC, OBJECT_VERSION, partition->count, image->size};
+  memcpy(&header[4], image->widths, TYPE_CODES);
+  bool written = writeWords(file, header, 5);
+  /* The image is padded with zeros up to a word */
+  uint32_t length = imageLength(image);
+  uint32_t padding = 0;
+  written &= fwrite(image->bytes, 1, length, file) == length;
+  written &= fwrite(&padding, 1, imageWords(image) * sizeof(uint32_t) - length, file) ==
+             imageWords(image) * sizeof(uint32_t) - length;
+  for (int i = 0 ; i < partition->count && written ; i++) {
+    written = writeProcess(file, &partition->processes[i]);
+  }
+  written &= fclose(file) == 0;
+  return written;
+}
+
+
+/* ==================================
+              READING
+=================================== */
+
+/* Read a sequence of words */
+static bool readWords(FILE* file, uint32_t* words, size_t count) {
+  return fread(words, sizeof(uint32_t), count, file) == count;
+}
+
+
+/* Read a process into the next slot of a partition */
+static bool readProcess(FILE* file, Partition* partition) {
+  uint32_t header[4];
+  if (!readWords(file, header, 4)) return false;
+  /* Counts beyond the ISA are a corrupted file, not an allocation to attempt */
+  if (header[0] > 0xFFFFFF || header[1] > header[0] || header[2] > 0xFFFFFF) return false;
+  ProcessCode* process = newProcess(partition);
+  process->chunk = initChunk();
+  process->cycles = header[3];
+  /* The code is read in one go, in a chunk sized for it */
+  if (header[0] > 0) {
+    process->chunk->instructions = ALLOCATE_ARRAY(uint32_t, header[0]);
+    process->chunk->capacity = header[0];
+    if (!readWords(file, process->chunk->instructions, header[0])) return false;
+    process->chunk->count = header[0];
+  }
+  for (uint32_t i = 0 ; i < header[1] ; i++) {
+    uint32_t index;
+    if (!readWords(file, &index, 1) || index >= header[0]) return false;
+    recordRelocation(process, index);
+  }
+  for (uint32_t i = 0 ; i < header[2] ; i++) {
+    uint32_t access[2];
+    if (!readWords(file, access, 2)) return false;
+    recordAccess(process, access[0], access[1] != 0);
+  }
+  return true;
+}
+
+
+/* Append the processes of an object to a partition */
+bool readObject(Partition* partition, StateImage* image, const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) return false;
+  uint32_t header[5];
+  bool read = readWords(file, header, 5) && header[0] == OBJECT_MAGIC && header[1] == OBJECT_VERSION;
+  if (read) {
+    memcpy(image->widths, &header[4], TYPE_CODES);
+    sizeImage(image, header[3]);
+    uint32_t padded = imageWords(image) * sizeof(uint32_t);
+    read = fread(image->bytes, 1, imageLength(image), file) == imageLength(image) &&
+           fseek(file, padded - imageLength(image), SEEK_CUR) == 0;
+  }
+  for (uint32_t i = 0 ; read && i < header[2] ; i++) {
+    read = readProcess(file, partition);
+  }
+  fclose(file);
+  return read;
+}
@@ -0,0 +1,30 @@
+#ifndef sdvu_object_h
+#define sdvu_object_h
+
+#include "common.h"
+#include "image.h"
+#include "partition.h"
+
+/* ==================================
+        STRUCTS AND GLOBALS
+=================================== */
+
+/* Relocatable object of the processes of a model, linked into target binaries for any number of
+   targets without compiling again. All the fields are native 32-bit words:
+     header:  magic, version, number of processes, size of the state vector in bits, width of the
+              values of each type code (one byte each)
+     image:   initial state vector (see image.h), padded to whole words
+     process: number of instructions, of relocations and of accesses, estimated cycles,
+              then the instructions (jumps relative to the first one), the index of each jump
+              and the accesses (address, 1 if written else 0) */
+#define OBJECT_MAGIC   0x4F564453 /* "SDVO" */
+#define OBJECT_VERSION 3
+
+/* Write the processes of a partition (targets are not kept) and the initial state vector, false if
+   the file could not be written */
+bool writeObject(Partition* partition, StateImage* image, const char* path);
+/* Append the processes of an object to a partition and read its initial state vector in an empty
+   image, false if the file could not be read or is not an object */
+bool readObject(Partition* partition, StateImage* image, const char* path);
+
+#endif
@@ -0,0 +1,681 @@
+#include <stdio.h>
+
+#include "chunk.h"
+#include "common.h"
+#include "ir.h"
+#include "mmemory.h"
+#include "optimizer.h"
+#include "register.h"
+#include "sstring.h"
+
+/* ==================================
+             UTILITIES
+=================================== */
+
+/* The operand is a given immediate value */
+static bool isImm(Operand operand, int value) {
+  return operand.type == OPERAND_IMM && operand.imm == value;
+}
+
+
+/* The value can be encoded as an immediate */
+static bool fitsImm(int value) {
+  return value >= 0 && value <= MAX_IMM;
+}
+
+
+/* The operation code produces a boolean */
+static bool isComparison(unsigned int op_code) {
+  return op_code == OP_LT || op_code == OP_GT || op_code == OP_EQ;
+}
+
+
+/* Operation defining a temporary before a given index (temporaries are assigned once) */
+static IrOp* definition(IrProcess* process, Operand temp, int before) {
+  if (temp.type != OPERAND_TEMP) return NULL;
+  for (int i = before - 1 ; i >= 0 ; i--) {
+    IrOp* op = &process->ops[i];
+    if (op->dst.type == OPERAND_TEMP && op->dst.symbol == temp.symbol) return op;
+  }
+  return NULL;
+}
+
+
+/* The operand can only hold 0 or 1 */
+static bool isBoolean(IrProcess* process, Operand operand, int before) {
+  switch (operand.type) {
+    case OPERAND_IMM:    return operand.imm == 0 || operand.imm == 1;
+    case OPERAND_GLOBAL: return operand.valueType == VAL_BOOL;
+    case OPERAND_TEMP: {
+      IrOp* def = definition(process, operand, before);
+      if (def == NULL) return false;
+      int index = (int) (def - process->ops);
+      if (def->negated) return true;
+      switch (def->type) {
+        case IR_ASSIGN:    return isBoolean(process, def->a, index);
+        case IR_LOAD_ELEM: return def->elemType == VAL_BOOL;
+        case IR_BINARY:
+          if (isComparison(def->op_code)) return true;
+          if (def->op_code == OP_AND || def->op_code == OP_OR) {
+            return isBoolean(process, def->a, index) && isBoolean(process, def->b, index);
+          }
+          return false;
+        default:
+          return false;
+      }
+    }
+    default:
+      return false;
+  }
+}
+
+
+/* Evaluate a binary operation on immediate values, false if it can not be done at compile time */
+static bool evaluate(unsigned int op_code, int a, int b, int* result) {
+  switch (op_code) {
+    case OP_ADD: *result = a + b; break;
+    case OP_SUB: *result = a - b; break;
+    case OP_MUL: *result = a * b; break;
+    case OP_DIV:
+      if (b == 0) return false;
+      *result = a / b;
+      break;
+    case OP_MOD:
+      if (b == 0) return false;
+      *result = a % b;
+      break;
+    case OP_AND: *result = a & b; break;
+    case OP_OR:  *result = a | b; break;
+    case OP_LT:  *result = a < b; break;
+    case OP_GT:  *result = a > b; break;
+    case OP_EQ:  *result = a == b; break;
+    default: return false;
+  }
+  return true;
+}
+
+
+/* Rewriting
+========= */
+
+/* Turn the operation into the assignment of an immediate value (negation included) */
+static void assignImm(IrOp* op, int value) {
+  op->a = immOperand(op->negated ? !value : value);
+  op->b = noOperand();
+  op->type = IR_ASSIGN;
+  op->op_code = OP_NOP;
+  op->negated = false;
+}
+
+
+/* Turn a binary operation into the assignment of one of its operands */
+static void keepOperand(IrOp* op, bool keepLeft) {
+  if (!keepLeft) op->a = op->b;
+  op->b = noOperand();
+  op->type = IR_ASSIGN;
+  op->op_code = OP_NOP;
+}
+
+
+/* ==================================
+          CONSTANT FOLDING
+=================================== */
+
+/* Replace a temporary by the immediate value or temporary it was assigned */
+static void propagate(IrProcess* process, Operand* operand, int index, bool allowImm) {
+  IrOp* def = definition(process, *operand, index);
+  if (def == NULL || def->type != IR_ASSIGN || def->negated) return;
+  if (def->a.type == OPERAND_TEMP || (allowImm && def->a.type == OPERAND_IMM)) {
+    *operand = def->a;
+  }
+}
+
+
+/* Push the negation of a comparison with an immediate into the comparison itself */
+static void pushNegation(IrProcess* process, IrOp* op, int index) {
+  if (!op->negated) return;
+  Operand* a = &op->a;
+  Operand* b = &op->b;
+  switch (op->op_code) {
+    case OP_EQ:
+      /* not (x == k) is x == 1-k when x is a boolean */
+      if (b->type == OPERAND_IMM && (b->imm == 0 || b->imm == 1) && isBoolean(process, *a, index)) {
+        b->imm = 1 - b->imm;
+        op->negated = false;
+      } else if (a->type == OPERAND_IMM && (a->imm == 0 || a->imm == 1) && isBoolean(process, *b, index)) {
+        a->imm = 1 - a->imm;
+        op->negated = false;
+      }
+      break;
+    case OP_LT:
+      /* x >= k is x > k-1, k >= x is k+1 > x */
+      if (b->type == OPERAND_IMM && fitsImm(b->imm - 1)) {
+        b->imm -= 1;
+        op->op_code = OP_GT;
+        op->negated = false;
+      } else if (a->type == OPERAND_IMM && fitsImm(a->imm + 1)) {
+        a->imm += 1;
+        op->op_code = OP_GT;
+        op->negated = false;
+      }
+      break;
+    case OP_GT:
+      /* x <= k is x < k+1, k <= x is k-1 < x */
+      if (b->type == OPERAND_IMM && fitsImm(b->imm + 1)) {
+        b->imm += 1;
+        op->op_code = OP_LT;
+        op->negated = false;
+      } else if (a->type == OPERAND_IMM && fitsImm(a->imm - 1)) {
+        a->imm -= 1;
+        op->op_code = OP_LT;
+        op->negated = false;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+
+/* Apply the algebraic identities of the binary operations */
+static void simplifyBinary(IrProcess* process, IrOp* op, int index) {
+  if (isComparison(op->op_code)) pushNegation(process, op, index);
+  Operand a = op->a;
+  Operand b = op->b;
+  /* Both operands are known */
+  int result;
+  if (a.type == OPERAND_IMM && b.type == OPERAND_IMM &&
+      evaluate(op->op_code, a.imm, b.imm, &result) && fitsImm(result)) {
+    /* and/or are only folded on booleans so that bitwise and logical views agree */
+    if ((op->op_code != OP_AND && op->op_code != OP_OR) ||
+        (isBoolean(process, a, index) && isBoolean(process, b, index))) {
+      assignImm(op, result);
+      return;
+    }
+  }
+  /* Operation of a variable with itself */
+  if (isVariable(a) && operandsEqual(a, b)) {
+    switch (op->op_code) {
+      case OP_AND:
+      case OP_OR:  keepOperand(op, true); break;
+      case OP_SUB:
+      case OP_LT:
+      case OP_GT:  assignImm(op, 0); break;
+      case OP_EQ:  assignImm(op, 1); break;
+      default: break;
+    }
+    if (op->type != IR_BINARY) {
+      if (op->negated && op->a.type == OPERAND_IMM) assignImm(op, op->a.imm);
+      return;
+    }
+  }
+  switch (op->op_code) {
+    case OP_ADD:
+      if (isImm(b, 0)) keepOperand(op, true);
+      else if (isImm(a, 0)) keepOperand(op, false);
+      break;
+    case OP_SUB:
+      if (isImm(b, 0)) keepOperand(op, true);
+      break;
+    case OP_MUL:
+      if (isImm(a, 0) || isImm(b, 0)) assignImm(op, 0);
+      else if (isImm(b, 1)) keepOperand(op, true);
+      else if (isImm(a, 1)) keepOperand(op, false);
+      break;
+    case OP_DIV:
+      if (isImm(b, 1)) keepOperand(op, true);
+      break;
+    case OP_MOD:
+      if (isImm(b, 1)) assignImm(op, 0);
+      break;
+    case OP_AND:
+      if ((isImm(a, 0) && isBoolean(process, b, index)) || (isImm(b, 0) && isBoolean(process, a, index))) assignImm(op, 0);
+      else if (isImm(b, 1) && isBoolean(process, a, index)) keepOperand(op, true);
+      else if (isImm(a, 1) && isBoolean(process, b, index)) keepOperand(op, false);
+      break;
+    case OP_OR:
+      if ((isImm(a, 1) && isBoolean(process, b, index)) || (isImm(b, 1) && isBoolean(process, a, index))) assignImm(op, 1);
+      else if (isImm(b, 0) && isBoolean(process, a, index)) keepOperand(op, true);
+      else if (isImm(a, 0) && isBoolean(process, b, index)) keepOperand(op, false);
+      break;
+    case OP_EQ:
+      /* x == true is x itself when x is a boolean */
+      if (isImm(b, 1) && isBoolean(process, a, index)) keepOperand(op, true);
+      else if (isImm(a, 1) && isBoolean(process, b, index)) keepOperand(op, false);
+      break;
+    default:
+      break;
+  }
+  /* The identity left a negated immediate */
+  if (op->type == IR_ASSIGN && op->negated && op->a.type == OPERAND_IMM) assignImm(op, op->a.imm);
+}
+
+
+void foldConstants(IrProcess* process) {
+  for (int i = 0 ; i < process->count ; i++) {
+    IrOp* op = &process->ops[i];
+    /* Forward the known values of the temporaries read */
+    switch (op->type) {
+      case IR_BINARY:
+        propagate(process, &op->b, i, true);
+        /* Fallthrough */
+      case IR_ASSIGN:
+      case IR_LOAD_ELEM:
+        propagate(process, &op->a, i, true);
+        break;
+      case IR_STORE_ELEM:
+        propagate(process, &op->a, i, true);
+        propagate(process, &op->b, i, true);
+        break;
+      case IR_GUARD:
+        /* The jump needs its condition in a register */
+        propagate(process, &op->a, i, false);
+        break;
+      default:
+        break;
+    }
+    /* Simplify the operation */
+    if (op->type == IR_BINARY) {
+      simplifyBinary(process, op, i);
+    } else if (op->type == IR_ASSIGN && op->negated && op->a.type == OPERAND_IMM) {
+      assignImm(op, op->a.imm);
+    }
+  }
+
+  /* The copies that were forwarded to all their readers are not needed anymore */
+  for (int i = 0 ; i < process->count ; i++) {
+    IrOp* op = &process->ops[i];
+    if (op->type != IR_ASSIGN || op->negated || op->dst.type != OPERAND_TEMP) continue;
+    if (op->a.type != OPERAND_IMM && op->a.type != OPERAND_TEMP) continue;
+    bool read = false;
+    for (int j = i + 1 ; j < process->count && !read ; j++) {
+      read = readsVariable(&process->ops[j], op->dst.symbol);
+    }
+    if (!read) removeIrOp(op);
+  }
+  compactIrProcess(process);
+}
+
+
+/* ==================================
+        VALUE NUMBERING (CSE)
+=================================== */
+
+/* Temporaries kept alive by the reuse of a value, the others registers are left to the
+   globals and operands of an instruction (temporaries can not be spilled) */
+#define MAX_LIVE_TEMPS (REG_NUMBER - 3)
+
+/* The binary operation gives the same result with its operands swapped */
+static bool isCommutative(unsigned int op_code) {
+  return op_code == OP_ADD || op_code == OP_MUL || op_code == OP_AND ||
+         op_code == OP_OR  || op_code == OP_EQ;
+}
+
+
+/* The two operations compute the same value from the same operands */
+static bool sameValue(IrOp* op, IrOp* other) {
+  if (op->type != other->type || op->negated != other->negated) return false;
+  switch (op->type) {
+    case IR_ASSIGN:
+      return operandsEqual(op->a, other->a);
+    case IR_BINARY:
+      if (op->op_code != other->op_code) return false;
+      if (operandsEqual(op->a, other->a) && operandsEqual(op->b, other->b)) return true;
+      return isCommutative(op->op_code) && operandsEqual(op->a, other->b) && operandsEqual(op->b, other->a);
+    case IR_LOAD_ELEM:
+      return op->arraySymbol == other->arraySymbol && operandsEqual(op->a, other->a);
+    default:
+      return false;
+  }
+}
+
+
+/* The operation writes a global read by another one */
+static bool writesOperand(IrOp* writer, IrOp* reader) {
+  if (writer->dst.type != OPERAND_GLOBAL) return false;
+  return readsVariable(reader, writer->dst.symbol);
+}
+
+
+/* Live ranges of the temporaries, computed once per pass and kept up to date as the operations
+   become copies */
+typedef struct {
+  int* lastUses; /* Last operation reading the temporary defined by each operation (-1 if none is defined) */
+  int* live;     /* Number of temporaries defined before each operation and read at it or after */
+} LiveRanges;
+
+
+/* Index of the last operation reading a temporary defined at a given index, looking back from another index */
+static int lastUseBefore(IrProcess* process, int def, int before) {
+  for (int i = before - 1 ; i > def ; i--) {
+    if (readsVariable(&process->ops[i], process->ops[def].dst.symbol)) return i;
+  }
+  return def;
+}
+
+
+/* Count a temporary as live from the operation following its definition up to a given one (-1 to remove it) */
+static void countLive(LiveRanges* ranges, int from, int to, int delta) {
+  for (int k = from + 1 ; k <= to ; k++) ranges->live[k] += delta;
+}
+
+
+/* Live ranges of the temporaries of a process */
+static void initLiveRanges(IrProcess* process, LiveRanges* ranges) {
+  int count = process->count > 0 ? process->count : 1;
+  ranges->lastUses = ALLOCATE_ARRAY(int, count);
+  ranges->live = ALLOCATE_ARRAY(int, count);
+  /* Operation defining each temporary (they are assigned once), by ID */
+  int symbols = symbolCount(process) > 0 ? symbolCount(process) : 1;
+  int* defs = ALLOCATE_ARRAY(int, symbols);
+  for (int i = 0 ; i < symbols ; i++) defs[i] = -1;
+  for (int i = 0 ; i < process->count ; i++) {
+    IrOp* op = &process->ops[i];
+    ranges->live[i] = 0;
+    ranges->lastUses[i] = (op->dst.type == OPERAND_TEMP) ? i : -1;
+    Operand reads[2] = {op->a, op->b};
+    for (int r = 0 ; r < 2 ; r++) {
+      if (reads[r].type == OPERAND_TEMP && defs[reads[r].symbol] != -1) ranges->lastUses[defs[reads[r].symbol]] = i;
+    }
+    if (op->dst.type == OPERAND_TEMP) defs[op->dst.symbol] = i;
+  }
+  for (int i = 0 ; i < process->count ; i++) {
+    if (ranges->lastUses[i] != -1) countLive(ranges, i, ranges->lastUses[i], 1);
+  }
+  FREE(defs);
+}
+
+
+static void freeLiveRanges(LiveRanges* ranges) {
+  FREE(ranges->lastUses);
+  FREE(ranges->live);
+}
+
+
+/* The temporary defined at a given index can be kept alive until another index */
+static bool canExtend(LiveRanges* ranges, int def, int until) {
+  for (int k = ranges->lastUses[def] + 1 ; k <= until ; k++) {
+    if (ranges->live[k] + 1 > MAX_LIVE_TEMPS) return false;
+  }
+  return true;
+}
+
+
+/* The operation at a given index stops reading an operand, the temporary it was the last reader of dies earlier */
+static void dropRead(IrProcess* process, LiveRanges* ranges, Operand operand, int index) {
+  IrOp* def = definition(process, operand, index);
+  if (def == NULL) return;
+  int defIndex = (int) (def - process->ops);
+  if (ranges->lastUses[defIndex] != index) return;
+  int last = lastUseBefore(process, defIndex, index);
+  countLive(ranges, last, index, -1);
+  ranges->lastUses[defIndex] = last;
+}
+
+
+/* Look for a value available before an operation: the same computation into a temporary,
+   or the value last written to the global or array element it reads */
+static bool availableValue(IrProcess* process, int index, Operand* value) {
+  IrOp* op = &process->ops[index];
+  for (int j = index - 1 ; j >= 0 ; j--) {
+    IrOp* prev = &process->ops[j];
+    /* Forward the value written to a global that is copied */
+    if (op->type == IR_ASSIGN && !op->negated && op->a.type == OPERAND_GLOBAL &&
+        prev->dst.type == OPERAND_GLOBAL && prev->dst.symbol == op->a.symbol) {
+      if (prev->type != IR_ASSIGN || prev->negated || prev->a.type == OPERAND_GLOBAL) return false;
+      *value = prev->a;
+      return true;
+    }
+    /* An operand was overwritten */
+    if (writesOperand(prev, op)) return false;
+    /* Stores to the same array may alias the loaded element */
+    if (op->type == IR_LOAD_ELEM && prev->type == IR_STORE_ELEM && prev->arraySymbol == op->arraySymbol) {
+      if (operandsEqual(prev->a, op->a)) {
+        /* Same element, forward the stored value */
+        if (prev->b.type == OPERAND_GLOBAL) return false;
+        *value = prev->b;
+        return true;
+      }
+      /* Two different constant indices do not alias */
+      if (prev->a.type == OPERAND_IMM && op->a.type == OPERAND_IMM) continue;
+      return false;
+    }
+    if (prev->dst.type == OPERAND_TEMP && sameValue(op, prev)) {
+      *value = prev->dst;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void eliminateCommonSubexpressions(IrProcess* process) {
+  LiveRanges ranges;
+  initLiveRanges(process, &ranges);
+  for (int i = 0 ; i < process->count ; i++) {
+    IrOp* op = &process->ops[i];
+    /* Only the values going to a temporary are reused, a global is written anyway */
+    if (op->dst.type != OPERAND_TEMP) continue;
+    if (op->type != IR_BINARY && op->type != IR_LOAD_ELEM &&
+        !(op->type == IR_ASSIGN && op->a.type == OPERAND_GLOBAL)) continue;
+    Operand value;
+    if (!availableValue(process, i, &value)) continue;
+    /* The temporary reused has to stay in a register until now */
+    IrOp* def = definition(process, value, i);
+    int defIndex = (def != NULL) ? (int) (def - process->ops) : -1;
+    if (def != NULL && !canExtend(&ranges, defIndex, i)) continue;
+    /* The operands are not read anymore, the reused temporary is read up to here */
+    Operand a = op->a;
+    Operand b = op->b;
+    op->a = noOperand();
+    op->b = noOperand();
+    dropRead(process, &ranges, a, i);
+    dropRead(process, &ranges, b, i);
+    if (def != NULL && ranges.lastUses[defIndex] < i) {
+      countLive(&ranges, ranges.lastUses[defIndex], i, 1);
+      ranges.lastUses[defIndex] = i;
+    }
+    /* The operation becomes a copy, forwarded to its readers by the folding */
+    Operand dst = op->dst;
+    int line = op->line;
+    *op = initIrOp(IR_ASSIGN, line);
+    op->dst = dst;
+    op->a = value;
+  }
+  freeLiveRanges(&ranges);
+}
+
+
+/* ==================================
+     SHORT-CIRCUIT GUARD EVALUATION
+=================================== */
+
+/* List of the conjuncts of a guard */
+typedef struct {
+  int count;
+  int capacity;
+  Operand* operands;
+} Conjuncts;
+
+
+/* Split a guard operand into the operands of its AND-chain (both sides have to be
+   booleans for the bitwise and to be a conjunction) */
+static void collectConjuncts(IrProcess* process, Operand operand, int before, Conjuncts* conjuncts) {
+  IrOp* def = definition(process, operand, before);
+  if (def != NULL && def->type == IR_BINARY && def->op_code == OP_AND && !def->negated) {
+    int index = (int) (def - process->ops);
+    if (isBoolean(process, def->a, index) && isBoolean(process, def->b, index)) {
+      collectConjuncts(process, def->a, index, conjuncts);
+      collectConjuncts(process, def->b, index, conjuncts);
+      return;
+    }
+  }
+  if (conjuncts->capacity < conjuncts->count + 1) {
+    int oldCapacity = conjuncts->capacity;
+    conjuncts->capacity = GROW_CAPACITY(oldCapacity);
+    conjuncts->operands = GROW_ARRAY(Operand, conjuncts->operands, conjuncts->capacity);
+  }
+  conjuncts->operands[conjuncts->count++] = operand;
+}
+
+
+/* Move a guard block operation to the new order, after the operations it depends on */
+static void place(IrProcess* process, int index, bool* placed, IrOp* ops, int* count) {
+  if (placed[index]) return;
+  placed[index] = true;
+  IrOp* op = &process->ops[index];
+  IrOp* defA = definition(process, op->a, index);
+  IrOp* defB = definition(process, op->b, index);
+  if (defA != NULL) place(process, (int) (defA - process->ops), placed, ops, count);
+  if (defB != NULL) place(process, (int) (defB - process->ops), placed, ops, count);
+  ops[(*count)++] = *op;
+}
+
+
+void shortCircuitGuard(IrProcess* process) {
+  int guard = process->guardIndex;
+  if (guard < 0) return;
+  /* Operations can only be moved after a jump if they do not write memory */
+  for (int i = 0 ; i < guard ; i++) {
+    IrOp* op = &process->ops[i];
+    if (op->type == IR_GUARD || op->type == IR_STORE_ELEM || op->dst.type == OPERAND_GLOBAL) return;
+  }
+  Conjuncts conjuncts = {0, 0, NULL};
+  collectConjuncts(process, process->ops[guard].a, guard, &conjuncts);
+  bool constant = false;
+  for (int i = 0 ; i < conjuncts.count ; i++) {
+    constant = constant || conjuncts.operands[i].type == OPERAND_IMM;
+  }
+  if (conjuncts.count < 2 || constant) {
+    FREE(conjuncts.operands);
+    return;
+  }
+
+  /* Each conjunct is computed then tested, the rest of the guard block is only computed
+     if all of them hold (the AND-chain itself becomes dead) */
+  IrOp* ops = ALLOCATE_ARRAY(IrOp, process->count + conjuncts.count);
+  bool* placed = ALLOCATE_ARRAY(bool, guard);
+  for (int i = 0 ; i < guard ; i++) placed[i] = false;
+  int count = 0;
+  int lastGuard = -1;
+  for (int i = 0 ; i < conjuncts.count ; i++) {
+    Operand conjunct = conjuncts.operands[i];
+    IrOp* def = definition(process, conjunct, guard);
+    if (def != NULL) place(process, (int) (def - process->ops), placed, ops, &count);
+    IrOp test = initIrOp(IR_GUARD, process->ops[guard].line);
+    test.a = conjunct;
+    lastGuard = count;
+    ops[count++] = test;
+  }
+  for (int i = 0 ; i < guard ; i++) {
+    if (!placed[i]) ops[count++] = process->ops[i];
+  }
+  removeIrOp(&process->ops[guard]);
+  for (int i = guard + 1 ; i < process->count ; i++) {
+    ops[count++] = process->ops[i];
+  }
+
+  FREE(process->ops);
+  process->ops = ops;
+  process->count = count;
+  process->capacity = process->count;
+  process->guardIndex = lastGuard;
+  FREE(placed);
+  FREE(conjuncts.operands);
+}
+
+
+/* ==================================
+        DEAD CODE ELIMINATION
+=================================== */
+
+/* The global written by an operation is read or observed before being overwritten */
+static bool globalIsLive(IrProcess* process, int index) {
+  int symbol = process->ops[index].dst.symbol;
+  for (int i = index + 1 ; i < process->count ; i++) {
+    IrOp* op = &process->ops[i];
+    /* Memory is observed if the effect is skipped */
+    if (op->type == IR_GUARD || readsVariable(op, symbol)) return true;
+    if (op->dst.type == OPERAND_GLOBAL && op->dst.symbol == symbol) return false;
+  }
+  /* Memory is observed at the end of the process */
+  return true;
+}
+
+
+/* The array element written by an operation is read or observed before being overwritten */
+static bool elementIsLive(IrProcess* process, int index) {
+  IrOp* store = &process->ops[index];
+  for (int i = index + 1 ; i < process->count ; i++) {
+    IrOp* op = &process->ops[i];
+    if (op->type == IR_GUARD) return true;
+    /* Any element of the array may be read */
+    if (op->type == IR_LOAD_ELEM && op->arraySymbol == store->arraySymbol) return true;
+    /* The index changes, the next stores do not write the same element */
+    if (writesOperand(op, store)) return true;
+    if (op->type == IR_STORE_ELEM && op->arraySymbol == store->arraySymbol && operandsEqual(op->a, store->a)) return false;
+  }
+  return true;
+}
+
+
+/* The temporary written by an operation is read later */
+static bool tempIsLive(IrProcess* process, int index) {
+  int symbol = process->ops[index].dst.symbol;
+  for (int i = index + 1 ; i < process->count ; i++) {
+    if (readsVariable(&process->ops[i], symbol)) return true;
+  }
+  return false;
+}
+
+
+/* The operation writes back the value a global already holds (copy of the global to a temporary) */
+static bool isSelfCopy(IrProcess* process, int index) {
+  IrOp* op = &process->ops[index];
+  if (op->type != IR_ASSIGN || op->negated || op->dst.type != OPERAND_GLOBAL) return false;
+  if (operandsEqual(op->a, op->dst)) return true;
+  IrOp* def = definition(process, op->a, index);
+  if (def == NULL || def->type != IR_ASSIGN || def->negated || !operandsEqual(def->a, op->dst)) return false;
+  /* The global must not have been written in between */
+  for (IrOp* between = def + 1 ; between < op ; between++) {
+    if (writesOperand(between, def)) return false;
+  }
+  return true;
+}
+
+
+void eliminateDeadCode(IrProcess* process) {
+  /* Going backward, the reads of the removed operations do not keep anything alive */
+  for (int i = process->count - 1 ; i >= 0 ; i--) {
+    IrOp* op = &process->ops[i];
+    bool live = true;
+    switch (op->type) {
+      case IR_ASSIGN:
+      case IR_BINARY:
+      case IR_LOAD_ELEM:
+        if (op->dst.type == OPERAND_TEMP) live = tempIsLive(process, i);
+        else live = !isSelfCopy(process, i) && globalIsLive(process, i);
+        break;
+      case IR_STORE_ELEM:
+        live = elementIsLive(process, i);
+        break;
+      default:
+        break;
+    }
+    if (!live) removeIrOp(op);
+  }
+  compactIrProcess(process);
+}
+
+
+/* ==================================
+          PASS PIPELINE
+=================================== */
+
+void optimizeProcess(IrProcess* process) {
+  foldConstants(process);
+  eliminateCommonSubexpressions(process);
+  foldConstants(process);
+  shortCircuitGuard(process);
+  eliminateDeadCode(process);
+}
@@ -0,0 +1,20 @@
+#ifndef sdvu_optimizer_h
+#define sdvu_optimizer_h
+
+#include "common.h"
+#include "ir.h"
+
+/* Run the optimization passes on the IR of a process */
+void optimizeProcess(IrProcess* process);
+
+/* Optimization passes */
+/* Evaluate constant operations, propagate constant and copied temporaries, apply algebraic identities */
+void foldConstants(IrProcess* process);
+/* Reuse the values already computed in temporaries (value numbering), and forward stored values */
+void eliminateCommonSubexpressions(IrProcess* process);
+/* Test each conjunct of an AND-chain guard with its own early-exit jump */
+void shortCircuitGuard(IrProcess* process);
+/* Remove the writes to temporaries never read and to globals or elements overwritten before being observed */
+void eliminateDeadCode(IrProcess* process);
+
+#endif
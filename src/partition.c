@@ -0,0 +1,530 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "chunk.h"
+#include "mmemory.h"
+#include "partition.h"
+
+/* ==================================
+            COST MODEL
+=================================== */
+
+/* Estimated cycles per instruction class. These are relative weights, not
+   measured latencies: the ALU operations take one cycle, the multiplier and
+   the divider several, and the accesses to the state vector pay the memory. */
+#define CYCLES_ALU    1
+#define CYCLES_MUL    3
+#define CYCLES_DIV    8
+#define CYCLES_MEMORY 2
+#define CYCLES_JUMP   1
+
+/* Estimated cycles of a single instruction */
+static uint32_t instructionCycles(uint32_t instruction) {
+  unsigned int op_code = instruction >> 28;
+  switch (op_code) {
+    case OP_MUL:   return CYCLES_MUL;
+    case OP_DIV:
+    case OP_MOD:   return CYCLES_DIV;
+    case OP_STORE: return CYCLES_MEMORY;
+    case OP_LOAD: {
+      /* Loads from a register or an immediate do not access the memory */
+      unsigned int cfg = (instruction >> 26) & 0b11;
+      return (cfg == LOAD_ADR || cfg == LOAD_RAA) ? CYCLES_MEMORY : CYCLES_ALU;
+    }
+    case OP_JMP:
+    case OP_ENDGA: return CYCLES_JUMP;
+    default:       return CYCLES_ALU;
+  }
+}
+
+/* Estimated cycles of a chunk if every instruction is executed once */
+uint32_t estimateCycles(Chunk* chunk) {
+  uint32_t cycles = 0;
+  for (int i = 0 ; i < chunk->count ; i++) {
+    cycles += instructionCycles(chunk->instructions[i]);
+  }
+  return cycles;
+}
+
+
+/* ==================================
+      ALLOCATION - DEALLOCATION
+=================================== */
+
+/* Partition initialization, with room for the expected number of processes */
+Partition* initPartition(int expected) {
+  Partition* partition = ALLOCATE_OBJ(Partition);
+  partition->count = 0;
+  partition->capacity = expected > 0 ? expected : 0;
+  partition->processes = expected > 0 ? ALLOCATE_ARRAY(ProcessCode, expected) : NULL;
+  return partition;
+}
+
+/* Partition destruction */
+void freePartition(Partition* partition) {
+  for (int i = 0 ; i < partition->count ; i++) {
+    if (partition->processes[i].chunk != NULL) freeChunk(partition->processes[i].chunk);
+    FREE(partition->processes[i].accesses);
+    FREE(partition->processes[i].relocations);
+  }
+  FREE(partition->processes);
+  FREE(partition);
+}
+
+/* Record an access of a process to a global, once per global */
+void recordAccess(ProcessCode* process, uint32_t address, bool written) {
+  for (int i = 0 ; i < process->accessCount ; i++) {
+    if (process->accesses[i].address == address) {
+      process->accesses[i].written |= written;
+      return;
+    }
+  }
+  if (process->accessCapacity < process->accessCount + 1) {
+    process->accessCapacity = GROW_CAPACITY(process->accessCapacity);
+    process->accesses = GROW_ARRAY(Access, process->accesses, process->accessCapacity);
+  }
+  Access* access = &process->accesses[process->accessCount++];
+  access->address = address;
+  access->written = written;
+  access->variable = -1;
+}
+
+/* Add a relocation for a jump of a process */
+void recordRelocation(ProcessCode* process, uint32_t index) {
+  if (process->relocationCapacity < process->relocationCount + 1) {
+    process->relocationCapacity = GROW_CAPACITY(process->relocationCapacity);
+    process->relocations = GROW_ARRAY(uint32_t, process->relocations, process->relocationCapacity);
+  }
+  process->relocations[process->relocationCount++] = index;
+}
+
+/* Record the globals read by an operand */
+static void recordOperand(ProcessCode* process, Operand operand) {
+  if (operand.type == OPERAND_GLOBAL) recordAccess(process, operand.address, false);
+}
+
+/* Take ownership of the chunk of a compiled process and record the globals its IR accesses */
+void addProcess(Partition* partition, Chunk* chunk, IrProcess* ir) {
+  newProcess(partition);
+  setProcess(partition, partition->count - 1, chunk, ir);
+}
+
+/* Empty process */
+static void clearProcess(ProcessCode* process) {
+  process->chunk = NULL;
+  process->cycles = 0;
+  process->target = 0;
+  process->relocationCount = 0;
+  process->relocationCapacity = 0;
+  process->relocations = NULL;
+  process->accessCount = 0;
+  process->accessCapacity = 0;
+  process->accesses = NULL;
+}
+
+/* Append an empty process, filled by the caller */
+ProcessCode* newProcess(Partition* partition) {
+  if (partition->capacity < partition->count + 1) {
+    partition->capacity = GROW_CAPACITY(partition->capacity);
+    partition->processes = GROW_ARRAY(ProcessCode, partition->processes, partition->capacity);
+  }
+  ProcessCode* process = &partition->processes[partition->count++];
+  clearProcess(process);
+  return process;
+}
+
+/* Make room for a known number of processes, each one is then set once */
+void reserveProcesses(Partition* partition, int count) {
+  if (partition->capacity < count) {
+    partition->capacity = count;
+    partition->processes = GROW_ARRAY(ProcessCode, partition->processes, partition->capacity);
+  }
+  for (int i = partition->count ; i < count ; i++) {
+    clearProcess(&partition->processes[i]);
+  }
+  partition->count = count;
+}
+
+/* Take ownership of the chunk of the compiled process at a given index and record the globals its IR accesses */
+void setProcess(Partition* partition, int index, Chunk* chunk, IrProcess* ir) {
+  ProcessCode* process = &partition->processes[index];
+  clearProcess(process);
+  process->chunk = chunk;
+  process->cycles = estimateCycles(chunk);
+  /* The jumps are the only instructions holding an address in the code */
+  for (int i = 0 ; i < chunk->count ; i++) {
+    if (chunk->instructions[i] >> 28 == OP_JMP) recordRelocation(process, i);
+  }
+  for (int i = 0 ; i < ir->count ; i++) {
+    IrOp* op = &ir->ops[i];
+    recordOperand(process, op->a);
+    recordOperand(process, op->b);
+    if (op->type == IR_ASSIGN || op->type == IR_BINARY) {
+      if (op->dst.type == OPERAND_GLOBAL) recordAccess(process, op->dst.address, true);
+    } else if (op->type == IR_LOAD_ELEM) {
+      recordAccess(process, op->base, false);
+    } else if (op->type == IR_STORE_ELEM) {
+      recordAccess(process, op->base, true);
+    }
+  }
+}
+
+
+/* ==================================
+            ACCESS GRAPH
+=================================== */
+
+/* Bipartite graph between the processes and the globals they access */
+typedef struct {
+  int variableCount; /* Number of distinct globals accessed */
+  int nbTargets;     /* Number of targets */
+  int* users;        /* Processes of each target accessing a global, nbTargets entries per global */
+  int* writers;      /* Processes writing each global */
+} AccessGraph;
+
+/* Order the addresses */
+static int compareAddress(const void* a, const void* b) {
+  uint32_t x = *(const uint32_t*)a;
+  uint32_t y = *(const uint32_t*)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+/* Number the accessed globals and count their users with the current assignment */
+static AccessGraph initAccessGraph(Partition* partition, int nbTargets) {
+  AccessGraph graph;
+  graph.nbTargets = nbTargets;
+  /* Sorted distinct addresses */
+  int total = 0;
+  for (int i = 0 ; i < partition->count ; i++) total += partition->processes[i].accessCount;
+  uint32_t* addresses = ALLOCATE_ARRAY(uint32_t, total > 0 ? total : 1);
+  int count = 0;
+  for (int i = 0 ; i < partition->count ; i++) {
+    ProcessCode* process = &partition->processes[i];
+    for (int j = 0 ; j < process->accessCount ; j++) addresses[count++] = process->accesses[j].address;
+  }
+  qsort(addresses, count, sizeof(uint32_t), compareAddress);
+  graph.variableCount = 0;
+  for (int i = 0 ; i < count ; i++) {
+    if (i == 0 || addresses[i] != addresses[i-1]) addresses[graph.variableCount++] = addresses[i];
+  }
+  graph.users = ALLOCATE_ARRAY(int, graph.variableCount * nbTargets + 1);
+  graph.writers = ALLOCATE_ARRAY(int, graph.variableCount + 1);
+  memset(graph.users, 0, sizeof(int) * graph.variableCount * nbTargets);
+  memset(graph.writers, 0, sizeof(int) * graph.variableCount);
+  /* Edges */
+  for (int i = 0 ; i < partition->count ; i++) {
+    ProcessCode* process = &partition->processes[i];
+    for (int j = 0 ; j < process->accessCount ; j++) {
+      Access* access = &process->accesses[j];
+      uint32_t* found = bsearch(&access->address, addresses, graph.variableCount, sizeof(uint32_t), compareAddress);
+      access->variable = (int)(found - addresses);
+      graph.users[access->variable * nbTargets + process->target]++;
+      if (access->written) graph.writers[access->variable]++;
+    }
+  }
+  FREE(addresses);
+  return graph;
+}
+
+static void freeAccessGraph(AccessGraph* graph) {
+  FREE(graph->users);
+  FREE(graph->writers);
+}
+
+/* The global is written and accessed from several targets */
+static bool isConflict(AccessGraph* graph, int variable) {
+  if (graph->writers[variable] == 0) return false;
+  int targets = 0;
+  for (int t = 0 ; t < graph->nbTargets ; t++) {
+    if (graph->users[variable * graph->nbTargets + t] > 0) targets++;
+  }
+  return targets > 1;
+}
+
+/* Move a process to another target, keeping the users up to date */
+static void moveProcess(AccessGraph* graph, ProcessCode* process, int target) {
+  for (int i = 0 ; i < process->accessCount ; i++) {
+    int variable = process->accesses[i].variable;
+    graph->users[variable * graph->nbTargets + process->target]--;
+    graph->users[variable * graph->nbTargets + target]++;
+  }
+  process->target = target;
+}
+
+/* Number of conflicts removed by moving a process to another target */
+static int moveGain(AccessGraph* graph, ProcessCode* process, int target) {
+  int from = process->target;
+  int before = 0;
+  for (int i = 0 ; i < process->accessCount ; i++) {
+    if (isConflict(graph, process->accesses[i].variable)) before++;
+  }
+  moveProcess(graph, process, target);
+  int after = 0;
+  for (int i = 0 ; i < process->accessCount ; i++) {
+    if (isConflict(graph, process->accesses[i].variable)) after++;
+  }
+  moveProcess(graph, process, from);
+  return before - after;
+}
+
+
+/* ==================================
+            PARTITIONING
+=================================== */
+
+/* Order by decreasing cycles, then by source order (position in the processes array) */
+static int compareCost(const void* a, const void* b) {
+  ProcessCode* p = *(ProcessCode* const*)a;
+  ProcessCode* q = *(ProcessCode* const*)b;
+  if (p->cycles != q->cycles) return p->cycles > q->cycles ? -1 : 1;
+  return (p > q) - (p < q);
+}
+
+/* Processes from the most to the least expensive */
+static ProcessCode** costOrder(Partition* partition) {
+  ProcessCode** order = ALLOCATE_ARRAY(ProcessCode*, partition->count);
+  for (int i = 0 ; i < partition->count ; i++) order[i] = &partition->processes[i];
+  qsort(order, partition->count, sizeof(ProcessCode*), compareCost);
+  return order;
+}
+
+/* Same number of processes per target, the first targets take the remainder */
+static void partitionByCount(Partition* partition, int nbTargets) {
+  int perTarget = partition->count / nbTargets;
+  int additional = partition->count % nbTargets;
+  int target = 0;
+  int inTarget = 0;
+  for (int i = 0 ; i < partition->count ; i++) {
+    partition->processes[i].target = target;
+    inTarget++;
+    if (inTarget == perTarget + (target < additional ? 1 : 0)) {
+      target++;
+      inTarget = 0;
+    }
+  }
+}
+
+/* Index of the most loaded target */
+static int slowestTarget(uint64_t* loads, int nbTargets) {
+  int slowest = 0;
+  for (int t = 1 ; t < nbTargets ; t++) {
+    if (loads[t] > loads[slowest]) slowest = t;
+  }
+  return slowest;
+}
+
+/* Move a process out of the slowest target, or swap it with a cheaper one,
+   when the receiving target stays below the current load of the slowest */
+static bool improveSlowest(Partition* partition, uint64_t* loads, int nbTargets) {
+  int slowest = slowestTarget(loads, nbTargets);
+  for (int i = 0 ; i < partition->count ; i++) {
+    ProcessCode* moved = &partition->processes[i];
+    if (moved->target != slowest) continue;
+    for (int t = 0 ; t < nbTargets ; t++) {
+      if (t == slowest) continue;
+      if (loads[t] + moved->cycles < loads[slowest]) {
+        loads[slowest] -= moved->cycles;
+        loads[t] += moved->cycles;
+        moved->target = t;
+        return true;
+      }
+      for (int j = 0 ; j < partition->count ; j++) {
+        ProcessCode* swapped = &partition->processes[j];
+        if (swapped->target != t || swapped->cycles >= moved->cycles) continue;
+        uint64_t delta = moved->cycles - swapped->cycles;
+        if (loads[t] + delta < loads[slowest]) {
+          loads[slowest] -= delta;
+          loads[t] += delta;
+          moved->target = t;
+          swapped->target = slowest;
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+/* Longest processing time first: each process, from the most to the least
+   expensive, goes to the least loaded target (the lowest index on a tie),
+   then the slowest target is relieved while it can be */
+static void partitionByCost(Partition* partition, int nbTargets) {
+  ProcessCode** order = costOrder(partition);
+  uint64_t* loads = ALLOCATE_ARRAY(uint64_t, nbTargets);
+  for (int t = 0 ; t < nbTargets ; t++) loads[t] = 0;
+  for (int i = 0 ; i < partition->count ; i++) {
+    int lightest = 0;
+    for (int t = 1 ; t < nbTargets ; t++) {
+      if (loads[t] < loads[lightest]) lightest = t;
+    }
+    ProcessCode* process = order[i];
+    process->target = lightest;
+    loads[lightest] += process->cycles;
+  }
+  while (improveSlowest(partition, loads, nbTargets));
+  FREE(loads);
+  FREE(order);
+}
+
+/* Processes sharing written globals go to the same target. From the most to
+   the least expensive, each process goes to the target already holding most
+   of its written globals, unless this target would exceed the tolerated load.
+   Single moves then remove the conflicts left, under the same bound. */
+static void partitionByAffinity(Partition* partition, int nbTargets) {
+  for (int i = 0 ; i < partition->count ; i++) partition->processes[i].target = 0;
+  AccessGraph graph = initAccessGraph(partition, nbTargets);
+  memset(graph.users, 0, sizeof(int) * graph.variableCount * nbTargets);
+  /* Tolerated load of a target */
+  uint64_t total = 0;
+  uint64_t bound = 0;
+  for (int i = 0 ; i < partition->count ; i++) {
+    total += partition->processes[i].cycles;
+    if (partition->processes[i].cycles > bound) bound = partition->processes[i].cycles;
+  }
+  uint64_t tolerated = total * (100 + AFFINITY_TOLERANCE) / (100 * nbTargets);
+  if (tolerated > bound) bound = tolerated;
+  /* Greedy placement */
+  ProcessCode** order = costOrder(partition);
+  uint64_t* loads = ALLOCATE_ARRAY(uint64_t, nbTargets);
+  for (int t = 0 ; t < nbTargets ; t++) loads[t] = 0;
+  for (int i = 0 ; i < partition->count ; i++) {
+    ProcessCode* process = order[i];
+    int best = -1;
+    int bestAffinity = -1;
+    for (int t = 0 ; t < nbTargets ; t++) {
+      if (loads[t] + process->cycles > bound) continue;
+      int affinity = 0;
+      for (int j = 0 ; j < process->accessCount ; j++) {
+        int variable = process->accesses[j].variable;
+        if (graph.writers[variable] > 0 && graph.users[variable * nbTargets + t] > 0) affinity++;
+      }
+      if (affinity > bestAffinity || (affinity == bestAffinity && loads[t] < loads[best])) {
+        best = t;
+        bestAffinity = affinity;
+      }
+    }
+    /* No target can take it within the tolerance */
+    if (best == -1) {
+      best = 0;
+      for (int t = 1 ; t < nbTargets ; t++) {
+        if (loads[t] < loads[best]) best = t;
+      }
+    }
+    process->target = best;
+    loads[best] += process->cycles;
+    for (int j = 0 ; j < process->accessCount ; j++) {
+      graph.users[process->accesses[j].variable * nbTargets + best]++;
+    }
+  }
+  /* Remove the conflicts left by single moves */
+  bool moved = true;
+  while (moved) {
+    moved = false;
+    for (int i = 0 ; i < partition->count ; i++) {
+      ProcessCode* process = &partition->processes[i];
+      int best = -1;
+      int bestGain = 0;
+      for (int t = 0 ; t < nbTargets ; t++) {
+        if (t == process->target || loads[t] + process->cycles > bound) continue;
+        int gain = moveGain(&graph, process, t);
+        if (gain > bestGain) {
+          best = t;
+          bestGain = gain;
+        }
+      }
+      if (best == -1) continue;
+      loads[process->target] -= process->cycles;
+      loads[best] += process->cycles;
+      moveProcess(&graph, process, best);
+      moved = true;
+    }
+  }
+  FREE(loads);
+  FREE(order);
+  freeAccessGraph(&graph);
+}
+
+/* Assign a target to each process */
+void partitionProcesses(Partition* partition, int nbTargets, PartitionMode mode) {
+  if (partition->count == 0 || nbTargets < 1) return;
+  switch (mode) {
+    case PARTITION_COUNT:    partitionByCount(partition, nbTargets); break;
+    case PARTITION_COST:     partitionByCost(partition, nbTargets); break;
+    case PARTITION_AFFINITY: partitionByAffinity(partition, nbTargets); break;
+  }
+}
+
+/* Concatenate the processes of a target in source order, patching their relocations */
+Chunk* targetChunk(Partition* partition, int target) {
+  Chunk* chunk = initChunk();
+  for (int i = 0 ; i < partition->count ; i++) {
+    ProcessCode* process = &partition->processes[i];
+    if (process->target != target) continue;
+    uint32_t offset = chunk->count;
+    for (int j = 0 ; j < process->chunk->count ; j++) {
+      writeChunk(chunk, process->chunk->instructions[j]);
+    }
+    for (int r = 0 ; r < process->relocationCount ; r++) {
+      uint32_t* instruction = &chunk->instructions[offset + process->relocations[r]];
+      *instruction = (*instruction & 0xFF000000) | (((*instruction & 0xFFFFFF) + offset) & 0xFFFFFF);
+    }
+  }
+  return chunk;
+}
+
+
+/* ==================================
+             REPORTING
+=================================== */
+
+/* Print the number of processes, instructions, estimated cycles and shared written globals of each target */
+void reportPartition(FILE* outstream, Partition* partition, int nbTargets) {
+  AccessGraph graph = initAccessGraph(partition, nbTargets);
+  uint64_t makespan = 0;
+  for (int t = 0 ; t < nbTargets ; t++) {
+    int processes = 0;
+    int instructions = 0;
+    uint64_t cycles = 0;
+    for (int i = 0 ; i < partition->count ; i++) {
+      ProcessCode* process = &partition->processes[i];
+      if (process->target != t) continue;
+      processes++;
+      instructions += process->chunk->count;
+      cycles += process->cycles;
+    }
+    if (processes == 0) continue;
+    if (cycles > makespan) makespan = cycles;
+    int conflicts = 0;
+    for (int v = 0 ; v < graph.variableCount ; v++) {
+      if (graph.users[v * nbTargets + t] > 0 && isConflict(&graph, v)) conflicts++;
+    }
+    fprintf(outstream, "Target %d: %d processes, %d instructions, %llu estimated cycles, %d shared written globals\n",
+            t, processes, instructions, (unsigned long long)cycles, conflicts);
+  }
+  int conflicts = 0;
+  for (int v = 0 ; v < graph.variableCount ; v++) {
+    if (isConflict(&graph, v)) conflicts++;
+  }
+  fprintf(outstream, "Estimated cycles of the slowest target: %llu\n", (unsigned long long)makespan);
+  fprintf(outstream, "Written globals shared between targets: %d of %d\n", conflicts, graph.variableCount);
+  freeAccessGraph(&graph);
+}
+
+/* Read a partition mode from its command line name */
+bool parsePartitionMode(const char* name, PartitionMode* mode) {
+  if (strcmp(name, "count") == 0) {
+    *mode = PARTITION_COUNT;
+    return true;
+  }
+  if (strcmp(name, "cost") == 0) {
+    *mode = PARTITION_COST;
+    return true;
+  }
+  if (strcmp(name, "affinity") == 0) {
+    *mode = PARTITION_AFFINITY;
+    return true;
+  }
+  return false;
+}
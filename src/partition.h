@@ -0,0 +1,78 @@
+#ifndef sdvu_partition_h
+#define sdvu_partition_h
+
+#include <stdio.h>
+
+#include "common.h"
+#include "chunk.h"
+#include "ir.h"
+
+/* ==================================
+        STRUCTS AND GLOBALS
+=================================== */
+
+/* Strategies distributing the processes over the targets */
+typedef enum {
+  PARTITION_COUNT,   /* Same number of processes per target, in source order */
+  PARTITION_COST,    /* Balance the estimated cycles of the targets (longest processes first) */
+  PARTITION_AFFINITY /* Keep the processes sharing written globals together, within a load tolerance */
+} PartitionMode;
+
+/* Tolerated load of a target above the average in affinity mode, in percent */
+#define AFFINITY_TOLERANCE 10
+
+/* Access of a process to a global variable */
+typedef struct {
+  uint32_t address; /* Address of the variable, base address of an array */
+  bool written;     /* The process writes the variable */
+  int variable;     /* Index of the variable in the access graph */
+} Access;
+
+/* Compiled process */
+typedef struct {
+  Chunk* chunk;    /* Instructions of the process, jumps relative to its first instruction */
+  uint32_t cycles; /* Estimated cycles of one execution of the process */
+  int target;      /* Target the process is assigned to */
+  int relocationCount;    /* Number of jumps */
+  int relocationCapacity; /* Size of the relocations array */
+  uint32_t* relocations;  /* Index of each jump, its address is moved by the start of the process */
+  int accessCount;    /* Number of globals accessed */
+  int accessCapacity; /* Size of the accesses array */
+  Access* accesses;   /* Globals read or written by the process */
+} ProcessCode;
+
+/* Compiled processes of a program, in source order */
+typedef struct {
+  int count;              /* Number of processes */
+  int capacity;           /* Size of the processes array */
+  ProcessCode* processes; /* Compiled processes */
+} Partition;
+
+/* Allocation/Deallocation routine */
+Partition* initPartition(int expected);
+void freePartition(Partition* partition);
+
+/* Take ownership of the chunk of a compiled process and record the globals its IR accesses */
+void addProcess(Partition* partition, Chunk* chunk, IrProcess* ir);
+/* Make room for a known number of processes, each one is then set once (possibly from different threads) */
+void reserveProcesses(Partition* partition, int count);
+/* Take ownership of the chunk of the compiled process at a given index and record the globals its IR accesses */
+void setProcess(Partition* partition, int index, Chunk* chunk, IrProcess* ir);
+/* Append an empty process, filled by the caller (the chunk is owned by the partition) */
+ProcessCode* newProcess(Partition* partition);
+/* Record an access of a process to a global, once per global */
+void recordAccess(ProcessCode* process, uint32_t address, bool written);
+/* Add a relocation for a jump of a process */
+void recordRelocation(ProcessCode* process, uint32_t index);
+/* Estimated cycles of a chunk if every instruction is executed once */
+uint32_t estimateCycles(Chunk* chunk);
+/* Assign a target to each process */
+void partitionProcesses(Partition* partition, int nbTargets, PartitionMode mode);
+/* Concatenate the processes of a target in source order, patching their relocations */
+Chunk* targetChunk(Partition* partition, int target);
+/* Print the number of processes, instructions, estimated cycles and shared written globals of each target */
+void reportPartition(FILE* outstream, Partition* partition, int nbTargets);
+/* Read a partition mode from its command line name */
+bool parsePartitionMode(const char* name, PartitionMode* mode);
+
+#endif
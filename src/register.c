@@ -5,20 +5,31 @@
 /* Register initialization */
 Register* initRegister(int number) {
   Register* reg = ALLOCATE_OBJ(Register);
+  setRegister(reg, number);
+  return reg;
+}
+
+
+/* Initialize a register in place (an element of a register file) */
+void setRegister(Register* reg, int number) {
   reg->varName = NULL;
+  reg->symbol = -1;
   reg->varValue = NIL_VAL;
   reg->number = number;
   reg->address = 0;
-  return reg;
+  reg->isDirty = false;
+  reg->isLocked = false;
 }
 
 
 /* Empty register */
 void emptyRegister(Register* reg) {
-  if (reg->varName != NULL) freeString(reg->varName);
   reg->varName = NULL;
+  reg->symbol = -1;
   reg->varValue = NIL_VAL;
   reg->address = 0;
+  reg->isDirty = false;
+  reg->isLocked = false;
 }
 
 
@@ -39,4 +50,5 @@ void loadVariable(Register* reg, String* varName, Value varValue, uint32_t varAd
   reg->varName = varName;
   reg->varValue = varValue;
   reg->address = varAddress;
+  reg->isDirty = false;
 }
@@ -10,13 +10,18 @@
 /* Register structure */
 typedef struct {
   String* varName;  /* Name of the variable in the register */
+  int symbol;       /* ID of the variable in the register (-1 if none) */
   Value varValue;   /* Value of the variable in the register */
   int number;       /* Register number */
   uint32_t address; /* Store the address in case of a global variable */
+  bool isDirty;     /* The global variable was written since it was loaded */
+  bool isLocked;    /* The register is an operand of the instruction being built */
 } Register;
 
 /* Register initialization */
 Register* initRegister(int number);
+/* Register initialization in place, for a register that is not allocated on its own */
+void setRegister(Register* reg, int number);
 /* Empty a given register */
 void emptyRegister(Register* reg);
 /* Free a given register */
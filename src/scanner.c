@@ -2,26 +2,56 @@
 #include <string.h>
 
 #include "common.h"
+#include "mmemory.h"
 #include "scanner.h"
 
+/* Character classes are tested a block at a time when the target has vector instructions
+   (the address sanitizer would see the aligned loads past the '\0' as overflows) */
+#if defined(__AVX2__) && !defined(__SANITIZE_ADDRESS__)
+#include <immintrin.h>
+#define SCANNER_SIMD
+#define BLOCK_SIZE 32
+typedef __m256i Block;
+#define LOAD_BLOCK(p)   _mm256_load_si256((const Block*)(p))
+#define SPLAT(c)        _mm256_set1_epi8(c)
+#define EQ(a, b)        _mm256_cmpeq_epi8(a, b)
+#define GT(a, b)        _mm256_cmpgt_epi8(a, b)
+#define OR(a, b)        _mm256_or_si256(a, b)
+#define AND(a, b)       _mm256_and_si256(a, b)
+#define MOVEMASK(a)     ((uint32_t)_mm256_movemask_epi8(a))
+#define FULL_MASK       0xFFFFFFFFu
+#elif defined(__SSE2__) && !defined(__SANITIZE_ADDRESS__)
+#include <emmintrin.h>
+#define SCANNER_SIMD
+#define BLOCK_SIZE 16
+typedef __m128i Block;
+#define LOAD_BLOCK(p)   _mm_load_si128((const Block*)(p))
+#define SPLAT(c)        _mm_set1_epi8(c)
+#define EQ(a, b)        _mm_cmpeq_epi8(a, b)
+#define GT(a, b)        _mm_cmpgt_epi8(a, b)
+#define OR(a, b)        _mm_or_si128(a, b)
+#define AND(a, b)       _mm_and_si128(a, b)
+#define MOVEMASK(a)     ((uint32_t)_mm_movemask_epi8(a))
+#define FULL_MASK       0xFFFFu
+#endif
+
 /* ==================================
         STRUCTS AND GLOBALS
 =================================== */
 
-typedef struct {
-  char* start;   /* Start of the lexem being scanned */
-  char* current; /* Current character being scanned */
-  int line;      /* Line number for error reporting */
-} Scanner;
+/* Scanner initialization */
+void initScanner(Scanner* scanner, char* source) {
+  scanner->start = source;
+  scanner->current = source;
+  scanner->line = 1;
+}
 
-/* Scanner singleton */
-static Scanner scanner;
 
-/* Scanner initialization */
-void initScanner(char* source) {
-  scanner.start = source;
-  scanner.current = source;
-  scanner.line = 1;
+/* Scanner initialization at the 'process' keyword of a process */
+void initScannerAt(Scanner* scanner, char* source, ProcessOffset* start) {
+  scanner->start = source + start->offset;
+  scanner->current = source + start->offset;
+  scanner->line = start->line;
 }
 
 
@@ -30,8 +60,8 @@ void initScanner(char* source) {
 ====================================*/
 
 /* Check if the current character is EOF */
-static bool isAtEnd() {
-  return *scanner.current == '\0';
+static bool isAtEnd(Scanner* scanner) {
+  return *scanner->current == '\0';
 }
 
 
@@ -55,60 +85,142 @@ static bool isIDPunctuation(char c) {
 }
 
 
+#ifdef SCANNER_SIMD
+/* Block tests
+=========== */
+
+/* Mask of the characters of a block in a range (signed comparison, bytes over 127 are out) */
+static inline Block inRange(Block chars, char low, char high) {
+  return AND(GT(chars, SPLAT(low - 1)), GT(SPLAT(high + 1), chars));
+}
+
+
+/* Mask of the characters of an identifier: letters, digits, '_' and '.' */
+static inline uint32_t identifierMask(Block chars) {
+  /* Setting the 0x20 bit folds the upper case letters on the lower case ones */
+  Block letters = inRange(OR(chars, SPLAT(0x20)), 'a', 'z');
+  Block punctuation = OR(EQ(chars, SPLAT('_')), EQ(chars, SPLAT('.')));
+  return MOVEMASK(OR(OR(letters, inRange(chars, '0', '9')), punctuation));
+}
+
+
+/* Mask of the digits */
+static inline uint32_t digitMask(Block chars) {
+  return MOVEMASK(inRange(chars, '0', '9'));
+}
+
+
+/* Mask of the characters before the end of a line */
+static inline uint32_t lineMask(Block chars) {
+  return ~MOVEMASK(OR(EQ(chars, SPLAT('\n')), EQ(chars, SPLAT('\0')))) & FULL_MASK;
+}
+
+
+/* Skip the characters of a class, the '\0' must not be part of it. The loads are aligned on the
+   block size, a block never crosses a page so it can not read past the page of the '\0'. */
+static inline char* spanClass(char* current, uint32_t (*classMask)(Block)) {
+  size_t offset = (uintptr_t)current & (BLOCK_SIZE - 1);
+  char* block = current - offset;
+  /* The characters before the current one are ignored */
+  uint32_t outside = ~classMask(LOAD_BLOCK(block)) & (FULL_MASK << offset) & FULL_MASK;
+  while (outside == 0) {
+    block += BLOCK_SIZE;
+    outside = ~classMask(LOAD_BLOCK(block)) & FULL_MASK;
+  }
+  return block + __builtin_ctz(outside);
+}
+
+
+/* Skip spaces, tabulations and line returns, counting the lines */
+static inline char* spanBlanks(char* current, int* line) {
+  /* Most tokens are separated by at most one space, not worth a block */
+  if (current[0] != ' ' && current[0] != '\t' && current[0] != '\r' && current[0] != '\n') return current;
+  if (current[0] == ' ' && current[1] != ' ' && current[1] != '\t' && current[1] != '\r' && current[1] != '\n') {
+    return current + 1;
+  }
+  size_t offset = (uintptr_t)current & (BLOCK_SIZE - 1);
+  char* block = current - offset;
+  uint32_t start = (FULL_MASK << offset) & FULL_MASK;
+  for (;;) {
+    Block chars = LOAD_BLOCK(block);
+    uint32_t newlines = MOVEMASK(EQ(chars, SPLAT('\n'))) & start;
+    Block blanks = OR(OR(EQ(chars, SPLAT(' ')), EQ(chars, SPLAT('\t'))), EQ(chars, SPLAT('\r')));
+    uint32_t outside = ~(MOVEMASK(blanks) | newlines) & start;
+    if (outside != 0) {
+      uint32_t end = __builtin_ctz(outside);
+      /* Only the line returns before the first other character are counted */
+      *line += __builtin_popcount(newlines & ((1u << end) - 1));
+      return block + end;
+    }
+    *line += __builtin_popcount(newlines);
+    block += BLOCK_SIZE;
+    start = FULL_MASK;
+  }
+}
+#endif
+
+
 /* ==================================
             SCAN HELPERS
 ====================================*/
 
 /* Consume the current character and return it */
-static char advance() {
-  scanner.current++;
-  return scanner.current[-1];
+static char advance(Scanner* scanner) {
+  scanner->current++;
+  return scanner->current[-1];
 }
 
 
 /* Return the current scanned character */
-static char peek() {
-  return *scanner.current;
+static char peek(Scanner* scanner) {
+  return *scanner->current;
 }
 
 
 /* Return the character next to the currently scanned one */
-static char peekNext() {
-  if (isAtEnd()) return '\0';
-  return scanner.current[1];
+static char peekNext(Scanner* scanner) {
+  if (isAtEnd(scanner)) return '\0';
+  return scanner->current[1];
 }
 
 
 /* Check that the current character is the expected */
-static bool match(char expected) {
-  if (isAtEnd()) return false;
-  if (*scanner.current != expected) return false;
+static bool match(Scanner* scanner, char expected) {
+  if (isAtEnd(scanner)) return false;
+  if (*scanner->current != expected) return false;
   /* Increment the counter */
-  scanner.current++;
+  scanner->current++;
   return true;
 }
 
 
 /* Skip all whitspace characters */
-static void skipWhitespace() {
+static void skipWhitespace(Scanner* scanner) {
   for (;;) {
-    char c = peek();
+#ifdef SCANNER_SIMD
+    scanner->current = spanBlanks(scanner->current, &scanner->line);
+#endif
+    char c = peek(scanner);
     switch (c) {
       case ' ':
       case '\r':
       case '\t':
-        advance();
+        advance(scanner);
         break;
       /* carriage return */
       case '\n':
-        scanner.line++;
-        advance();
+        scanner->line++;
+        advance(scanner);
         break;
       /* comment */
       case '/':
-        if (peekNext() == '/') {
+        if (peekNext(scanner) == '/') {
           /* A comment goes until the end of the line. */
-          while (peek() != '\n' && !isAtEnd()) advance();
+#ifdef SCANNER_SIMD
+          scanner->current = spanClass(scanner->current, lineMask);
+#else
+          while (peek(scanner) != '\n' && !isAtEnd(scanner)) advance(scanner);
+#endif
         } else {
           return;
         }
@@ -125,25 +237,28 @@ static void skipWhitespace() {
           TOKEN CREATION
 ====================================*/
 
+/* Message of the only scanning error */
+static char unexpectedCharacter[] = "Unexpected character.";
+
 /* Create a token from a type */
-static Token makeToken(TokenType type) {
+static Token makeToken(Scanner* scanner, TokenType type) {
   Token token;
   token.type = type;
-  token.start = scanner.start;
-  token.length = (int)(scanner.current - scanner.start);
-  token.line = scanner.line;
+  token.start = scanner->start;
+  token.length = (int)(scanner->current - scanner->start);
+  token.line = scanner->line;
 
   return token;
 }
 
 
 /* Create an error token with a message and the line */
-static Token errorToken(char* message) {
+static Token errorToken(Scanner* scanner, char* message) {
   Token token;
   token.type = TOKEN_ERROR;
   token.start = message;
   token.length = (int)strlen(message);
-  token.line = scanner.line;
+  token.line = scanner->line;
 
   return token;
 }
@@ -154,12 +269,12 @@ static Token errorToken(char* message) {
 ====================================*/
 
 /* Check if a word is a reserved keyword */
-static TokenType checkKeyword(int start, int length, const char* rest, TokenType type) {
+static TokenType checkKeyword(Scanner* scanner, int start, int length, const char* rest, TokenType type) {
   /* Test if :
   - the lexeme is exactly as long as the reserved word
   - the characters are corresponding */
-  if (scanner.current - scanner.start == start + length &&
-      memcmp(scanner.start + start, rest, length) == 0) {
+  if (scanner->current - scanner->start == start + length &&
+      memcmp(scanner->start + start, rest, length) == 0) {
     return type;
   }
   return TOKEN_IDENTIFIER;
@@ -167,40 +282,40 @@ static TokenType checkKeyword(int start, int length, const char* rest, TokenType
 
 
 /* Define the identifier type, by comparing it to keywords */
-static TokenType identifierType() {
-  switch (scanner.start[0]) {
-    case 'a': return checkKeyword(1, 2, "nd", TOKEN_AND); // and
+static TokenType identifierType(Scanner* scanner) {
+  switch (scanner->start[0]) {
+    case 'a': return checkKeyword(scanner, 1, 2, "nd", TOKEN_AND); // and
     case 'b':
-      if (scanner.current - scanner.start > 1) {
-        switch (scanner.start[1]) {
-          case 'o': return checkKeyword(2, 2, "ol", TOKEN_BOOL);       // bool
-          case 'y': return checkKeyword(2, 2, "te", TOKEN_BYTE);       // byte
+      if (scanner->current - scanner->start > 1) {
+        switch (scanner->start[1]) {
+          case 'o': return checkKeyword(scanner, 2, 2, "ol", TOKEN_BOOL);       // bool
+          case 'y': return checkKeyword(scanner, 2, 2, "te", TOKEN_BYTE);       // byte
           default: break; // Unreachable
         }
       }
-    case 'e': return checkKeyword(1, 5, "ffect", TOKEN_EFFECT);        // effect
-    case 'f': return checkKeyword(1, 4, "alse", TOKEN_FALSE);          // false
+    case 'e': return checkKeyword(scanner, 1, 5, "ffect", TOKEN_EFFECT);        // effect
+    case 'f': return checkKeyword(scanner, 1, 4, "alse", TOKEN_FALSE);          // false
     case 'g':
-      if (scanner.current - scanner.start > 5) {
-        switch (scanner.start[5]) {
+      if (scanner->current - scanner->start > 5) {
+        switch (scanner->start[5]) {
           case 'b':
-          case 'B': return checkKeyword(6, 4, "lock", TOKEN_GUARD_BLOCK);     // guardblock
+          case 'B': return checkKeyword(scanner, 6, 4, "lock", TOKEN_GUARD_BLOCK);     // guardblock
           case 'c':
-          case 'C': return checkKeyword(6, 8, "ondition", TOKEN_GUARD_COND);  // guardcondition
+          case 'C': return checkKeyword(scanner, 6, 8, "ondition", TOKEN_GUARD_COND);  // guardcondition
           default: break; // Unreachable
         }
       }
-    case 'i': return checkKeyword(1, 2, "nt", TOKEN_INT);              // int
-    case 'n': return checkKeyword(1, 2, "ot", TOKEN_NOT);              // not
-    case 'o': return checkKeyword(1, 1, "r", TOKEN_OR);                // or
-    case 'p': return checkKeyword(1, 6, "rocess", TOKEN_PROCESS);      // process
-    case 's': return checkKeyword(1, 4, "tate", TOKEN_STATE);          // type
+    case 'i': return checkKeyword(scanner, 1, 2, "nt", TOKEN_INT);              // int
+    case 'n': return checkKeyword(scanner, 1, 2, "ot", TOKEN_NOT);              // not
+    case 'o': return checkKeyword(scanner, 1, 1, "r", TOKEN_OR);                // or
+    case 'p': return checkKeyword(scanner, 1, 6, "rocess", TOKEN_PROCESS);      // process
+    case 's': return checkKeyword(scanner, 1, 4, "tate", TOKEN_STATE);          // type
     case 't':
-      if (scanner.current - scanner.start > 1) {
-        switch (scanner.start[1]) {
-          case 'e': return checkKeyword(2, 2, "mp", TOKEN_TEMP);       // temp
-          case 'r': return checkKeyword(2, 2, "ue", TOKEN_TRUE);       // true
-          case 'u': return checkKeyword(2, 3, "ple", TOKEN_TUPLE);     // tuple
+      if (scanner->current - scanner->start > 1) {
+        switch (scanner->start[1]) {
+          case 'e': return checkKeyword(scanner, 2, 2, "mp", TOKEN_TEMP);       // temp
+          case 'r': return checkKeyword(scanner, 2, 2, "ue", TOKEN_TRUE);       // true
+          case 'u': return checkKeyword(scanner, 2, 3, "ple", TOKEN_TUPLE);     // tuple
           default: break; // Unreachable
         }
       }
@@ -211,27 +326,43 @@ static TokenType identifierType() {
 
 
 /* Create an identifier token */
-static Token identifier() {
+static Token identifier(Scanner* scanner) {
   /* Numbers are also allowed after the first letter */
-  while (isAlpha(peek()) || isDigit(peek()) || isIDPunctuation(peek())) advance();
-  return makeToken(identifierType());
+#ifdef SCANNER_SIMD
+  if (isAlpha(peek(scanner)) || isDigit(peek(scanner)) || isIDPunctuation(peek(scanner))) {
+    scanner->current = spanClass(scanner->current, identifierMask);
+  }
+#else
+  while (isAlpha(peek(scanner)) || isDigit(peek(scanner)) || isIDPunctuation(peek(scanner))) advance(scanner);
+#endif
+  return makeToken(scanner, identifierType(scanner));
+}
+
+
+/* Consume a run of digits */
+static void digits(Scanner* scanner) {
+#ifdef SCANNER_SIMD
+  if (isDigit(peek(scanner))) scanner->current = spanClass(scanner->current, digitMask);
+#else
+  while(isDigit(peek(scanner))) advance(scanner);
+#endif
 }
 
 
 /* Create a number token */
-static Token number() {
+static Token number(Scanner* scanner) {
   /* Consume the negative part */
-  if (peek() == '-') advance();
+  if (peek(scanner) == '-') advance(scanner);
   /* Consume the integer part */
-  while(isDigit(peek())) advance();
+  digits(scanner);
   /* Look for a decimal part */
-  if (peek() == '.' && isDigit(peekNext())) {
+  if (peek(scanner) == '.' && isDigit(peekNext(scanner))) {
     /* Consume the . */
-    advance();
+    advance(scanner);
   }
   /* Consume the decimal part */
-  while(isDigit(peek())) advance();
-  return makeToken(TOKEN_NUMBER);
+  digits(scanner);
+  return makeToken(scanner, TOKEN_NUMBER);
 }
 
 
@@ -240,52 +371,52 @@ static Token number() {
 ====================================*/
 
 /* Scan the current lexeme into a token */
-Token scanToken() {
-  skipWhitespace();
+Token scanToken(Scanner* scanner) {
+  skipWhitespace(scanner);
 
-  scanner.start = scanner.current;
+  scanner->start = scanner->current;
 
-  if (isAtEnd()) return makeToken(TOKEN_EOF);
+  if (isAtEnd(scanner)) return makeToken(scanner, TOKEN_EOF);
 
-  char c = advance();
+  char c = advance(scanner);
   /* Identifier */
-  if (isAlpha(c)) return identifier();
+  if (isAlpha(c)) return identifier(scanner);
   /* Digit */
-  if (c == '-'  && isDigit(peek())) return number();
-  if (isDigit(c)) return number();
+  if (c == '-'  && isDigit(peek(scanner))) return number(scanner);
+  if (isDigit(c)) return number(scanner);
 
   switch (c) {
     /* Single character */
-    case '(': return makeToken(TOKEN_LEFT_PAREN);
-    case ')': return makeToken(TOKEN_RIGHT_PAREN);
-    case '[': return makeToken(TOKEN_LEFT_SQBRACKET);
-    case ']': return makeToken(TOKEN_RIGHT_SQBRACKET);
-    case '{': return makeToken(TOKEN_LEFT_BRACE);
-    case '}': return makeToken(TOKEN_RIGHT_BRACE);
-    case ';': return makeToken(TOKEN_SEMICOLON);
-    case ',': return makeToken(TOKEN_COMMA);
-    case '.': return makeToken(TOKEN_DOT);
-    case '-': return makeToken(TOKEN_MINUS);
-    case '+': return makeToken(TOKEN_PLUS);
-    case '/': return makeToken(TOKEN_SLASH);
-    case '*': return makeToken(TOKEN_STAR);
-    case '%': return makeToken(TOKEN_MODULO);
+    case '(': return makeToken(scanner, TOKEN_LEFT_PAREN);
+    case ')': return makeToken(scanner, TOKEN_RIGHT_PAREN);
+    case '[': return makeToken(scanner, TOKEN_LEFT_SQBRACKET);
+    case ']': return makeToken(scanner, TOKEN_RIGHT_SQBRACKET);
+    case '{': return makeToken(scanner, TOKEN_LEFT_BRACE);
+    case '}': return makeToken(scanner, TOKEN_RIGHT_BRACE);
+    case ';': return makeToken(scanner, TOKEN_SEMICOLON);
+    case ',': return makeToken(scanner, TOKEN_COMMA);
+    case '.': return makeToken(scanner, TOKEN_DOT);
+    case '-': return makeToken(scanner, TOKEN_MINUS);
+    case '+': return makeToken(scanner, TOKEN_PLUS);
+    case '/': return makeToken(scanner, TOKEN_SLASH);
+    case '*': return makeToken(scanner, TOKEN_STAR);
+    case '%': return makeToken(scanner, TOKEN_MODULO);
     /* Double character */
     case '!':
-      if (match('=')) return makeToken(TOKEN_BANG_EQUAL);
+      if (match(scanner, '=')) return makeToken(scanner, TOKEN_BANG_EQUAL);
     case '=':
-      return makeToken(
-          match('=') ? TOKEN_EQUAL_EQUAL : TOKEN_EQUAL);
+      return makeToken(scanner, 
+          match(scanner, '=') ? TOKEN_EQUAL_EQUAL : TOKEN_EQUAL);
     case '<':
-      return makeToken(
-          match('=') ? TOKEN_LESS_EQUAL : TOKEN_LESS);
+      return makeToken(scanner, 
+          match(scanner, '=') ? TOKEN_LESS_EQUAL : TOKEN_LESS);
     case '>':
-      return makeToken(
-          match('=') ? TOKEN_GREATER_EQUAL : TOKEN_GREATER);
+      return makeToken(scanner, 
+          match(scanner, '=') ? TOKEN_GREATER_EQUAL : TOKEN_GREATER);
     default: break;
   }
 
-  return errorToken("Unexpected character.");
+  return errorToken(scanner, unexpectedCharacter);
 }
 
 
@@ -321,3 +452,127 @@ static const char* TokenNames[] = {
 void fprintToken(FILE* outstream, Token token) {
   fprintf(outstream, "%s\n", TokenNames[token.type]);
 }
+
+
+/* ==================================
+          PROCESS INDEX
+=================================== */
+
+/* Empty process index */
+static ProcessIndex* initProcessIndex() {
+  ProcessIndex* index = ALLOCATE_OBJ(ProcessIndex);
+  index->count = 0;
+  index->capacity = 0;
+  index->offsets = NULL;
+  return index;
+}
+
+
+/* Record the start of a process declaration */
+static void addProcessOffset(ProcessIndex* index, size_t offset, int line, int token) {
+  if (index->capacity < index->count + 1) {
+    int oldCapacity = index->capacity;
+    index->capacity = GROW_CAPACITY(oldCapacity);
+    index->offsets = GROW_ARRAY(ProcessOffset, index->offsets, index->capacity);
+  }
+  index->offsets[index->count].offset = offset;
+  index->offsets[index->count].line = line;
+  index->offsets[index->count].token = token;
+  index->count++;
+}
+
+
+/* Record the start of every process declaration */
+ProcessIndex* indexProcesses(char* source) {
+  ProcessIndex* index = initProcessIndex();
+  Scanner scanner;
+  initScanner(&scanner, source);
+  for (Token token = scanToken(&scanner) ; token.type != TOKEN_EOF ; token = scanToken(&scanner)) {
+    if (token.type == TOKEN_PROCESS) addProcessOffset(index, token.start - source, token.line, -1);
+  }
+  return index;
+}
+
+
+/* Record the start of every process declaration, with its token index */
+ProcessIndex* indexTokenProcesses(TokenBuffer* tokens) {
+  ProcessIndex* index = initProcessIndex();
+  for (int i = 0 ; i < tokens->count ; i++) {
+    if (tokens->types[i] == TOKEN_PROCESS) addProcessOffset(index, tokens->offsets[i], tokens->lines[i], i);
+  }
+  return index;
+}
+
+
+/* Free the process index */
+void freeProcessIndex(ProcessIndex* index) {
+  FREE(index->offsets);
+  FREE(index);
+}
+
+
+/* ==================================
+           TOKEN BUFFER
+=================================== */
+
+/* Append a scanned token to the buffer */
+static void addToken(TokenBuffer* tokens, Scanner* scanner, Token token) {
+  if (tokens->capacity < tokens->count + 1) {
+    int oldCapacity = tokens->capacity;
+    tokens->capacity = GROW_CAPACITY(oldCapacity);
+    tokens->types   = GROW_ARRAY(uint8_t, tokens->types, tokens->capacity);
+    tokens->offsets = GROW_ARRAY(uint32_t, tokens->offsets, tokens->capacity);
+    tokens->lengths = GROW_ARRAY(uint32_t, tokens->lengths, tokens->capacity);
+    tokens->lines   = GROW_ARRAY(uint32_t, tokens->lines, tokens->capacity);
+  }
+  /* The lexeme of an error is its message, the offending character is kept instead */
+  char* start = token.type == TOKEN_ERROR ? scanner->start : token.start;
+  tokens->types[tokens->count]   = (uint8_t)token.type;
+  tokens->offsets[tokens->count] = (uint32_t)(start - tokens->source);
+  tokens->lengths[tokens->count] = (uint32_t)token.length;
+  tokens->lines[tokens->count]   = (uint32_t)token.line;
+  tokens->count++;
+}
+
+
+/* Scan every token of a source, the EOF included */
+TokenBuffer* tokenizeSource(char* source) {
+  TokenBuffer* tokens = ALLOCATE_OBJ(TokenBuffer);
+  tokens->source = source;
+  tokens->count = 0;
+  tokens->capacity = 0;
+  tokens->types = NULL;
+  tokens->offsets = NULL;
+  tokens->lengths = NULL;
+  tokens->lines = NULL;
+  Scanner scanner;
+  initScanner(&scanner, source);
+  for (;;) {
+    Token token = scanToken(&scanner);
+    addToken(tokens, &scanner, token);
+    if (token.type == TOKEN_EOF) break;
+  }
+  return tokens;
+}
+
+
+/* Free the token buffer, the source stays owned by the caller */
+void freeTokenBuffer(TokenBuffer* tokens) {
+  FREE(tokens->types);
+  FREE(tokens->offsets);
+  FREE(tokens->lengths);
+  FREE(tokens->lines);
+  FREE(tokens);
+}
+
+
+/* Rebuild the token at a given index */
+Token tokenAt(TokenBuffer* tokens, int index) {
+  if (index >= tokens->count) index = tokens->count - 1;
+  Token token;
+  token.type = (TokenType)tokens->types[index];
+  token.start = token.type == TOKEN_ERROR ? unexpectedCharacter : tokens->source + tokens->offsets[index];
+  token.length = (int)tokens->lengths[index];
+  token.line = (int)tokens->lines[index];
+  return token;
+}
@@ -1,6 +1,8 @@
 #ifndef sdvu_scanner_h
 #define sdvu_scanner_h
 
+#include "common.h"
+
 /* Token types */
 typedef enum {
   /* Single-character tokens */
@@ -41,8 +43,56 @@ typedef struct {
   int line;
 } Token;
 
-void initScanner(char* source);
-Token scanToken();
+/* Scanner state, a copy saves the scanning position */
+typedef struct {
+  char* start;   /* Start of the lexem being scanned */
+  char* current; /* Current character being scanned */
+  int line;      /* Line number for error reporting */
+} Scanner;
+
+/* Tokens of a whole source, one array per field (sources under 4 GiB) */
+typedef struct {
+  char* source;       /* Source the offsets refer to */
+  int count;          /* Number of tokens, the last one is the EOF */
+  int capacity;       /* Size of the arrays */
+  uint8_t* types;     /* Type of each token */
+  uint32_t* offsets;  /* Byte offset of each lexeme (the offending character of an error) */
+  uint32_t* lengths;  /* Length of each lexeme */
+  uint32_t* lines;    /* Line of each token */
+} TokenBuffer;
+
+/* Start of a process declaration in the source */
+typedef struct {
+  size_t offset; /* Byte offset of the 'process' keyword */
+  int line;      /* Line of the 'process' keyword */
+  int token;     /* Index of the 'process' keyword in the token buffer (-1 without buffer) */
+} ProcessOffset;
+
+/* Process declarations of a source, found by a single scan before the compilation */
+typedef struct {
+  int count;               /* Number of 'process' tokens */
+  int capacity;            /* Size of the offsets array */
+  ProcessOffset* offsets;  /* Start of each process, in source order */
+} ProcessIndex;
+
+/* Scanning routine, the whole state is held by the caller */
+void initScanner(Scanner* scanner, char* source);
+/* Scanner resuming at the start of a process */
+void initScannerAt(Scanner* scanner, char* source, ProcessOffset* start);
+Token scanToken(Scanner* scanner);
 void fprintToken(FILE* outstream, Token token);
 
+/* Index the process declarations with a scan of the whole source (only real tokens are counted,
+   not 'process' inside an identifier or a comment) */
+ProcessIndex* indexProcesses(char* source);
+/* Index the process declarations of an already tokenized source */
+ProcessIndex* indexTokenProcesses(TokenBuffer* tokens);
+void freeProcessIndex(ProcessIndex* index);
+
+/* Scan a whole source once, the buffer is only read afterwards and can be shared */
+TokenBuffer* tokenizeSource(char* source);
+void freeTokenBuffer(TokenBuffer* tokens);
+/* Token at a given index, past the end it stays on the EOF */
+Token tokenAt(TokenBuffer* tokens, int index);
+
 #endif
@@ -0,0 +1,93 @@
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source.h"
+
+
+/* Error on an input file */
+static void fileError(const char* message, const char* path) {
+  fprintf(stderr, "%s \"%s\".\n", message, path);
+  exit(74);
+}
+
+
+/* Read the content of a file that can not be mapped (pipe, terminal) in a growing buffer */
+static Source readStream(int fd, const char* path) {
+  Source source = {NULL, 0, 0, 0};
+  size_t capacity = 0;
+  for (;;) {
+    if (capacity < source.length + 4096 + 1) {
+      capacity = capacity < 65536 ? 65536 : capacity * 2;
+      source.chars = (char*)realloc(source.chars, capacity);
+      if (source.chars == NULL) fileError("Not enough memory to read", path);
+    }
+    ssize_t bytesRead = read(fd, source.chars + source.length, capacity - source.length - 1);
+    if (bytesRead < 0) fileError("Could not read file", path);
+    if (bytesRead == 0) break;
+    source.length += bytesRead;
+  }
+  if (source.chars == NULL) {
+    source.chars = (char*)malloc(1);
+    if (source.chars == NULL) fileError("Not enough memory to read", path);
+  }
+  source.chars[source.length] = '\0';
+  return source;
+}
+
+
+/* Map a file in memory, the pages are read on demand instead of being copied */
+Source readFile(const char* path) {
+  /* Open the file */
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) fileError("Could not open file", path);
+  struct stat status;
+  if (fstat(fd, &status) < 0) fileError("Could not read file", path);
+  if (!S_ISREG(status.st_mode) || status.st_size == 0) {
+    Source source = readStream(fd, path);
+    close(fd);
+    return source;
+  }
+  /* Reserve one more byte than the file, the pages past its end are anonymous zeros so the
+     content is always followed by a '\0' (the end of the last page of the file is zeroed too) */
+  size_t length = status.st_size;
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t mapped = (length / page + 1) * page;
+  char* chars = mmap(NULL, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (chars == MAP_FAILED || mmap(chars, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    /* Mapping refused, fall back to a copy */
+    if (chars != MAP_FAILED) munmap(chars, mapped);
+    Source source = readStream(fd, path);
+    close(fd);
+    return source;
+  }
+  /* The scanner reads the file from start to end */
+  madvise(chars, length, MADV_SEQUENTIAL);
+  close(fd);
+  return (Source){chars, length, mapped, 0};
+}
+
+
+/* Give back the pages before an offset, a pass restarting from the start gives them back again */
+void releaseSource(Source* source, size_t offset) {
+  if (source->mapped == 0) return;
+  size_t end = offset - offset % sysconf(_SC_PAGESIZE);
+  size_t start = source->released <= end ? source->released : 0;
+  if (end > start) madvise(source->chars + start, end - start, MADV_DONTNEED);
+  source->released = end;
+}
+
+
+/* Release the content of a file */
+void freeSource(Source* source) {
+  if (source->mapped != 0) {
+    munmap(source->chars, source->mapped);
+  } else {
+    free(source->chars);
+  }
+}
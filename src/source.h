@@ -0,0 +1,21 @@
+#ifndef sdvu_source_h
+#define sdvu_source_h
+
+#include "common.h"
+
+/* Content of an input file, terminated by a '\0' for the scanner */
+typedef struct {
+  char* chars;     /* Content of the file */
+  size_t length;   /* Number of bytes of the content */
+  size_t mapped;   /* Size of the mapping, 0 if the content was read in a buffer */
+  size_t released; /* Bytes at the start of a mapping whose pages were given back */
+} Source;
+
+/* Map a file (or read it if it can not be mapped), exits on failure */
+Source readFile(const char* path);
+/* Give back the pages of a mapped file before an offset, they are read again from the file if
+   needed. A read buffer is kept as is. */
+void releaseSource(Source* source, size_t offset);
+void freeSource(Source* source);
+
+#endif
@@ -9,7 +9,7 @@
 ====================================*/
 
 /* Compute the hash using the FNV-1a hash function */
-static uint32_t hashString(const char* key, int length) {
+uint32_t hashString(const char* key, int length) {
   uint32_t hash = 2166136261u;
 
   for (int i = 0; i < length; i++) {
@@ -53,6 +53,29 @@ void assignString(String* string, char* key, int length) {
 }
 
 
+/* Allocate a new string holding the same characters */
+String* copyString(String* string) {
+  String* copy = initString();
+  copy->chars = malloc(sizeof(char) * (string->length + 1));
+  memcpy(copy->chars, string->chars, string->length + 1);
+  copy->length = string->length;
+  copy->hash = string->hash;
+  return copy;
+}
+
+
+/* Allocate a string and its characters in an arena */
+String* arenaString(Arena* arena, const char* key, int length) {
+  String* string = ARENA_OBJ(arena, String);
+  string->chars = ARENA_ARRAY(arena, char, length + 1);
+  memcpy(string->chars, key, length);
+  string->chars[length] = '\0';
+  string->length = length;
+  string->hash = hashString(key, length);
+  return string;
+}
+
+
 /* String comparison */
 bool stringsEqual(String* a, String* b) {
   if((a->hash != b->hash) || (a->length != b->length)) return false;
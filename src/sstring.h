@@ -2,6 +2,7 @@
 #define sdvu_string_h
 
 #include "common.h"
+#include "mmemory.h"
 
 /* Structure of a string (object) */
 typedef struct {
@@ -10,12 +11,18 @@ typedef struct {
   char* chars;   /* Characters composing the string */
 } String;
 
+/* FNV-1a hash of a character array */
+uint32_t hashString(const char* key, int length);
 /* Initialize the string */
 String* initString();
 /* Free a string */
 void freeString(String* string);
 /* Assign a character array to the string */
 void assignString(String* string, char* key, int length);
+/* Copy a string */
+String* copyString(String* string);
+/* String allocated in an arena, it is released with the arena and never freed on its own */
+String* arenaString(Arena* arena, const char* key, int length);
 /* String comparison */
 bool stringsEqual(String* string1, String* string2);
 
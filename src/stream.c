@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "chunk.h"
+#include "mmemory.h"
+#include "partition.h"
+#include "stream.h"
+
+/* ==================================
+      ALLOCATION - DEALLOCATION
+=================================== */
+
+/* Stream initialization, no file is opened before a target gets a process */
+Stream* initStream(int nbTargets, PartitionMode mode, int expected, char* binName) {
+  Stream* stream = ALLOCATE_OBJ(Stream);
+  stream->nbTargets = nbTargets;
+  stream->mode = mode;
+  stream->expected = expected;
+  stream->received = 0;
+  stream->binName = binName;
+  stream->targets = nbTargets > 0 ? ALLOCATE_ARRAY(TargetWriter, nbTargets) : NULL;
+  for (int t = 0 ; t < nbTargets ; t++) {
+    stream->targets[t].file = NULL;
+    stream->targets[t].processes = 0;
+    stream->targets[t].count = 0;
+    stream->targets[t].cycles = 0;
+    stream->targets[t].buffered = 0;
+  }
+  return stream;
+}
+
+
+/* Name of the output of a target */
+static void targetFileName(Stream* stream, int index, char* outFileName) {
+  snprintf(outFileName, 100, "%s.%d", stream->binName, index);
+}
+
+
+/* Write the buffered instructions of a target */
+static bool flushTarget(TargetWriter* target) {
+  size_t written = fwrite(target->buffer, sizeof(uint32_t), target->buffered, target->file);
+  bool flushed = written == (size_t)target->buffered;
+  target->buffered = 0;
+  return flushed;
+}
+
+
+/* Flush and close the outputs */
+bool closeStream(Stream* stream) {
+  bool closed = true;
+  for (int t = 0 ; t < stream->nbTargets ; t++) {
+    TargetWriter* target = &stream->targets[t];
+    if (target->file == NULL) continue;
+    closed &= flushTarget(target);
+    closed &= fclose(target->file) == 0;
+    target->file = NULL;
+  }
+  return closed;
+}
+
+
+/* Close and remove the outputs already written, after an error */
+void discardStream(Stream* stream) {
+  closeStream(stream);
+  for (int t = 0 ; t < stream->nbTargets ; t++) {
+    if (stream->targets[t].processes == 0) continue;
+    char outFileName[100];
+    targetFileName(stream, t, outFileName);
+    remove(outFileName);
+  }
+}
+
+
+/* Stream destruction, the outputs should be closed beforehand */
+void freeStream(Stream* stream) {
+  closeStream(stream);
+  FREE(stream->targets);
+  FREE(stream);
+}
+
+
+/* ==================================
+        ONLINE DISTRIBUTION
+=================================== */
+
+/* Target of the next process. In count mode the first targets take the remainder as in the
+   batch partition. The cost and affinity modes give each process to the least loaded target
+   so far, the accesses of the later processes are not known yet. */
+static int nextTarget(Stream* stream) {
+  int nbTargets = stream->nbTargets;
+  if (stream->mode == PARTITION_COUNT) {
+    int perTarget = stream->expected / nbTargets;
+    int additional = stream->expected % nbTargets;
+    int index = stream->received;
+    if (index < additional * (perTarget + 1)) return index / (perTarget + 1);
+    /* More processes than expected stay on the last target */
+    if (perTarget == 0) return nbTargets - 1;
+    int target = additional + (index - additional * (perTarget + 1)) / perTarget;
+    return target < nbTargets ? target : nbTargets - 1;
+  }
+  int lightest = 0;
+  for (int t = 1 ; t < nbTargets ; t++) {
+    if (stream->targets[t].cycles < stream->targets[lightest].cycles) lightest = t;
+  }
+  return lightest;
+}
+
+
+/* Open the output of a target */
+static bool openTarget(Stream* stream, int index) {
+  char outFileName[100];
+  targetFileName(stream, index, outFileName);
+  stream->targets[index].file = fopen(outFileName, "w");
+  if (stream->targets[index].file == NULL) {
+    fprintf(stderr, "Could not open file \"%s\".\n", outFileName);
+    return false;
+  }
+  return true;
+}
+
+
+/* Assign the chunk of the next process to a target and write it with its jumps relocated */
+bool streamProcess(Stream* stream, Chunk* chunk) {
+  /* Without target nothing is written, as in a batch compilation */
+  if (stream->nbTargets < 1) return true;
+  int index = nextTarget(stream);
+  stream->received++;
+  TargetWriter* target = &stream->targets[index];
+  if (target->file == NULL && !openTarget(stream, index)) return false;
+  bool written = true;
+  uint32_t offset = target->count;
+  for (int i = 0 ; i < chunk->count ; i++) {
+    uint32_t instruction = chunk->instructions[i];
+    if (instruction >> 28 == OP_JMP) {
+      instruction = (instruction & 0xFF000000) | (((instruction & 0xFFFFFF) + offset) & 0xFFFFFF);
+    }
+    target->buffer[target->buffered++] = instruction;
+    if (target->buffered == STREAM_BUFFER) written &= flushTarget(target);
+  }
+  target->processes++;
+  target->count += chunk->count;
+  target->cycles += estimateCycles(chunk);
+  return written;
+}
+
+
+/* ==================================
+             REPORTING
+=================================== */
+
+/* Print the number of processes, instructions and estimated cycles of each target */
+void reportStream(FILE* outstream, Stream* stream) {
+  uint64_t makespan = 0;
+  for (int t = 0 ; t < stream->nbTargets ; t++) {
+    TargetWriter* target = &stream->targets[t];
+    if (target->processes == 0) continue;
+    if (target->cycles > makespan) makespan = target->cycles;
+    fprintf(outstream, "Target %d: %d processes, %u instructions, %llu estimated cycles\n",
+            t, target->processes, target->count, (unsigned long long)target->cycles);
+  }
+  fprintf(outstream, "Estimated cycles of the slowest target: %llu\n", (unsigned long long)makespan);
+}
@@ -0,0 +1,51 @@
+#ifndef sdvu_stream_h
+#define sdvu_stream_h
+
+#include <stdio.h>
+
+#include "common.h"
+#include "chunk.h"
+#include "partition.h"
+
+/* ==================================
+        STRUCTS AND GLOBALS
+=================================== */
+
+/* Instructions gathered before a write to a target file */
+#define STREAM_BUFFER 4096
+
+/* Binary of a target, written as its processes are compiled */
+typedef struct {
+  FILE* file;        /* Output file, opened with the first process of the target */
+  int processes;     /* Number of processes written */
+  uint32_t count;    /* Number of instructions written, offset of the next process */
+  uint64_t cycles;   /* Estimated cycles of the processes written */
+  int buffered;      /* Number of instructions waiting in the buffer */
+  uint32_t buffer[STREAM_BUFFER]; /* Instructions not written yet */
+} TargetWriter;
+
+/* Processes distributed over the targets one at a time, none of them is kept once written */
+typedef struct {
+  int nbTargets;         /* Number of targets */
+  PartitionMode mode;    /* Distribution strategy, applied online */
+  int expected;          /* Total number of processes (count mode) */
+  int received;          /* Number of processes received so far */
+  char* binName;         /* Prefix of the output binaries */
+  TargetWriter* targets; /* Output of each target */
+} Stream;
+
+/* Allocation/Deallocation routine, the total number of processes is only needed in count mode */
+Stream* initStream(int nbTargets, PartitionMode mode, int expected, char* binName);
+/* Flush and close the outputs, false if a write failed */
+bool closeStream(Stream* stream);
+/* Close and remove the outputs written so far, after an error */
+void discardStream(Stream* stream);
+void freeStream(Stream* stream);
+
+/* Assign the chunk of the next process to a target and write it with its jumps relocated,
+   the chunk can be freed afterwards. False if the output could not be written. */
+bool streamProcess(Stream* stream, Chunk* chunk);
+/* Print the number of processes, instructions and estimated cycles of each target */
+void reportStream(FILE* outstream, Stream* stream);
+
+#endif
@@ -6,8 +6,10 @@
 #include "table.h"
 #include "value.h"
 
-/* Grow the array when it reaches 75% of its capacity */
+/* Grow the index when it reaches 75% of its capacity */
 #define TABLE_MAX_LOAD 0.75
+/* Load of the index built by a freeze, lower for shorter probes */
+#define TABLE_FROZEN_LOAD 0.5
 
 /* Allocate the memory for an entry */
 Entry* initEntry() {
@@ -15,6 +17,9 @@ Entry* initEntry() {
   entry->key = NULL;
   entry->value = NIL_VAL;
   entry->address = 0;
+  entry->symbol = -1;
+  entry->length = 1;
+  entry->constant = false;
   return entry;
 }
 
@@ -39,47 +44,69 @@ Table* initTable() {
   Table* table = ALLOCATE_OBJ(Table);
   table->count = 0;
   table->capacity = 0;
-  table->entries = NULL;
+  table->slots = NULL;
   table->currentAddress = 0;
+  table->symbolCount = 0;
+  table->symbolCapacity = 0;
+  table->symbols = NULL;
   return table;
 }
 
 
 /* Free the hash table */
 void freeTable(Table* table) {
-  FREE(table->entries);
+  FREE(table->slots);
+  FREE(table->symbols);
   FREE(table);
 }
 
 
 /* ==================================
-  FIND AN ENTRY IN ARRAY OF ENTRIES
+    FIND A SLOT IN THE HASH INDEX
 ====================================*/
 
-/* Find an entry corresponding to a given key, returns a pointer to the entry */
-static Entry* findEntry(Entry* entries, int capacity, String* key) {
-  /* Map of the hash to the table using the modulo of the capacity */
-  uint32_t index = key->hash % capacity;
-  Entry* tombstone = NULL;
-  for (;;) {
-    /* Return the entry at the given index in the table */
-    Entry* entry = &(entries[index]);
-
-    if (entry->key == NULL) {
-      if (IS_NIL(entry->value)) {
-        /* Empty entry */
-        return tombstone != NULL ? tombstone : entry;
-      } else {
-        /* Tombstone found */
-        if (tombstone == NULL) tombstone = entry;
-      }
-    } else if (stringsEqual(entry->key, key)) {
-      /* Key found */
-      return entry;
+/* Distance of a slot from the home slot of its hash */
+static uint32_t probeDistance(Table* table, uint32_t index) {
+  return (index - (table->slots[index].hash & (table->capacity - 1))) & (table->capacity - 1);
+}
+
+
+/* Find the slot of a given key (NULL if absent). The keys are ordered by probe distance
+   along a probe sequence, so the search stops at the first key closer to its home slot. */
+static Slot* findSlot(Table* table, const char* chars, int length, uint32_t hash) {
+  if (table->capacity == 0) return NULL;
+  uint32_t mask = table->capacity - 1;
+  uint32_t index = hash & mask;
+  for (uint32_t distance = 0 ;; distance++) {
+    Slot* slot = &table->slots[index];
+    if (slot->symbol == -1 || probeDistance(table, index) < distance) return NULL;
+    if (slot->hash == hash) {
+      String* key = table->symbols[slot->symbol].key;
+      if (key->length == length && memcmp(key->chars, chars, length) == 0) return slot;
     }
+    index = (index + 1) & mask;
+  }
+}
 
-    /* Linear probing to look for another place */
-    index = (index + 1) % capacity;
+
+/* Insert a slot for a key that is not in the index, taking the place of any key closer to its home */
+static void insertSlot(Table* table, Slot slot) {
+  uint32_t mask = table->capacity - 1;
+  uint32_t index = slot.hash & mask;
+  for (uint32_t distance = 0 ;; distance++) {
+    Slot* current = &table->slots[index];
+    if (current->symbol == -1) {
+      *current = slot;
+      return;
+    }
+    uint32_t currentDistance = probeDistance(table, index);
+    if (currentDistance < distance) {
+      Slot displaced = *current;
+      *current = slot;
+      slot = displaced;
+      distance = currentDistance;
+    }
+    index = (index + 1) & mask;
   }
 }
 
@@ -88,37 +115,46 @@ static Entry* findEntry(Entry* entries, int capacity, String* key) {
           SIZE OPERATIONS
 ====================================*/
 
-/* Allocate an array of entries */
+/* Rebuild the index with a given power of two number of slots */
 static void adjustCapacity(Table* table, int capacity) {
-  Entry* entries = ALLOCATE_ARRAY(Entry, capacity);
-  /* Fill the entries in the allocated array with NULL keys and NIL values*/
-  for (int i = 0; i < capacity; i++) {
-    entries[i].key = NULL;
-    entries[i].value = NIL_VAL;
-    entries[i].address = 0;
+  FREE(table->slots);
+  table->slots = ALLOCATE_ARRAY(Slot, capacity);
+  table->capacity = capacity;
+  /* Empty slots */
+  for (int i = 0 ; i < capacity ; i++) {
+    table->slots[i].hash = 0;
+    table->slots[i].symbol = -1;
+  }
+  /* The entries are reindexed from the symbols array, no need to keep the previous index */
+  for (int i = 0 ; i < table->symbolCount ; i++) {
+    Entry* entry = &table->symbols[i];
+    if (entry->key == NULL) continue;
+    insertSlot(table, (Slot){entry->key->hash, i});
   }
+}
 
-  /* Clear the tombstone count */
-  table->count = 0;
 
-  /* Report the entries from the old table to the new one */
-  for (int i = 0; i < table->capacity; i++) {
-    Entry* entry = &table->entries[i];
-    if (entry->key == NULL) continue;
+/* Smallest power of two number of slots holding a number of keys under a given load */
+static int capacityFor(int count, double load) {
+  int capacity = GROW_CAPACITY(0);
+  while (count > capacity * load) capacity *= 2;
+  return capacity;
+}
 
-    /* The new table is reused from scratch to handle potential collisions */
-    Entry* dest = findEntry(entries, capacity, entry->key);
-    dest->key = entry->key;
-    dest->value = entry->value;
-    dest->address = entry->address;
 
-    table->count++; /* Increment if non-tombstone */
+/* Give the next ID to a key */
+static Entry* newEntry(Table* table, String* key, Value value, uint32_t address) {
+  if (table->symbolCapacity < table->symbolCount + 1) {
+    int oldCapacity = table->symbolCapacity;
+    table->symbolCapacity = GROW_CAPACITY(oldCapacity);
+    table->symbols = GROW_ARRAY(Entry, table->symbols, table->symbolCapacity);
   }
-
-  /* Set the new entries and capacity */
-  FREE(table->entries);
-  table->entries = entries;
-  table->capacity = capacity;
+  Entry* entry = &table->symbols[table->symbolCount];
+  assignEntry(entry, key, value, address);
+  entry->symbol = table->symbolCount++;
+  entry->length = 1;
+  entry->constant = false;
+  return entry;
 }
 
 
@@ -128,26 +164,58 @@ static void adjustCapacity(Table* table, int capacity) {
 
 /* Set the value at the given key */
 void tableSet(Table* table, String* key, Value value, uint32_t address) {
+  /* Look for the key in the table */
+  Slot* slot = findSlot(table, key->chars, key->length, key->hash);
+  if (slot != NULL) {
+    assignEntry(&table->symbols[slot->symbol], key, value, address);
+    return;
+  }
   if (table->count + 1 > table->capacity * TABLE_MAX_LOAD) {
-    int capacity = GROW_CAPACITY(table->capacity);
-    adjustCapacity(table, capacity);
+    /* The new key is not in the symbols array yet, it is indexed below */
+    adjustCapacity(table, GROW_CAPACITY(table->capacity));
   }
+  Entry* entry = newEntry(table, key, value, address);
+  insertSlot(table, (Slot){key->hash, entry->symbol});
+  table->count++;
+}
 
-  /* Look for the key in the table */
-  Entry* entry = findEntry(table->entries, table->capacity, key);
-  /* The count is incremented if the key is not overwriting a tombstone*/
-  if(IS_NIL(entry->value)) table->count++;
 
-  entry->key = key;
-  entry->value = value;
-  entry->address = address;
+/* Append a key without indexing it, the index is built by the freeze */
+Entry* tableAppend(Table* table, String* key, Value value, uint32_t address) {
+  return newEntry(table, key, value, address);
+}
+
+
+/* Index every key in an index sized once for the final count */
+void tableFreeze(Table* table) {
+  FREE(table->slots);
+  table->capacity = capacityFor(table->symbolCount, TABLE_FROZEN_LOAD);
+  table->slots = ALLOCATE_ARRAY(Slot, table->capacity);
+  for (int i = 0 ; i < table->capacity ; i++) {
+    table->slots[i].hash = 0;
+    table->slots[i].symbol = -1;
+  }
+  table->count = 0;
+  for (int i = 0 ; i < table->symbolCount ; i++) {
+    Entry* entry = &table->symbols[i];
+    if (entry->key == NULL) continue;
+    Slot* slot = findSlot(table, entry->key->chars, entry->key->length, entry->key->hash);
+    if (slot != NULL) {
+      /* Declared again, the previous entry is superseded */
+      table->symbols[slot->symbol].key = NULL;
+      slot->symbol = i;
+    } else {
+      insertSlot(table, (Slot){entry->key->hash, i});
+      table->count++;
+    }
+  }
 }
 
 
 /* Copy the content of a hash table into another */
 void tableAddAll(Table* from, Table* to) {
-  for (int i = 0; i < from->capacity; i++) {
-    Entry* entry = &from->entries[i];
+  for (int i = 0; i < from->symbolCount; i++) {
+    Entry* entry = &from->symbols[i];
     if (entry->key != NULL) {
       tableSet(to, entry->key, entry->value, entry->address);
     }
@@ -157,35 +225,51 @@ void tableAddAll(Table* from, Table* to) {
 
 /* Get an entry for a given key and store the value in the corresponding pointers */
 bool tableGet(Table* table, String* key, Value* value, uint32_t* address) {
-  /* The table is empty */
-  if(table->count == 0) return false;
   /* Look for the entry corresponding to a given key */
-  Entry* entry = findEntry(table->entries, table->capacity, key);
-  if (entry->key == NULL) return false;
+  Slot* slot = findSlot(table, key->chars, key->length, key->hash);
+  if (slot == NULL) return false;
 
+  Entry* entry = &table->symbols[slot->symbol];
   *value   = entry->value;
   *address = entry->address;
   return true;
 }
 
-/* Delete an entry for a given key */
+/* Delete an entry for a given key, the following keys of the probe sequence are shifted back */
 bool tableDelete(Table* table, String* key) {
-  /* The table is empty */
-  if(table->count == 0) return false;
-
   /* Find the entry */
-  Entry* entry = findEntry(table->entries, table->capacity, key);
-  if(entry->key == NULL) return false;
-
-  /* Place a tombstone in the entry */
-  entry->key = NULL;
-  entry->value = BOOL_VAL(true); /* Tombstone is true */
-  entry->address = 0;
+  Slot* slot = findSlot(table, key->chars, key->length, key->hash);
+  if (slot == NULL) return false;
 
+  /* The ID is not given again, its entry is only marked as removed */
+  table->symbols[slot->symbol].key = NULL;
+  uint32_t mask = table->capacity - 1;
+  uint32_t index = slot - table->slots;
+  for (;;) {
+    uint32_t next = (index + 1) & mask;
+    if (table->slots[next].symbol == -1 || probeDistance(table, next) == 0) break;
+    table->slots[index] = table->slots[next];
+    index = next;
+  }
+  table->slots[index].symbol = -1;
+  table->count--;
   return true;
 }
 
 
+/* Look for a key given by its characters, without building a string */
+int tableSymbol(Table* table, const char* chars, int length) {
+  Slot* slot = findSlot(table, chars, length, hashString(chars, length));
+  return slot == NULL ? -1 : slot->symbol;
+}
+
+
+/* Entry of a given ID */
+Entry* tableEntry(Table* table, int symbol) {
+  return &table->symbols[symbol];
+}
+
+
 /* ==================================
     TABLE TO REGISTER OPERATIONS
 ====================================*/
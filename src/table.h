@@ -11,6 +11,9 @@ typedef struct {
   String* key;
   Value value;
   uint32_t address;
+  int symbol;       /* Dense ID of the key, given in insertion order */
+  int length;       /* Number of elements of an array, 1 for a single value */
+  bool constant;    /* Never written, its reads are immediates and it takes no room in the state vector */
 } Entry;
 
 /* Entry operations */
@@ -19,12 +22,21 @@ void assignEntry(Entry* entry, String* key, Value value, uint32_t address);
 void freeEntry(Entry* entry);
 
 
-/* Table structure, dynamic array of entries */
+/* Slot of the hash index, refers to an entry by its ID */
 typedef struct {
-  int count;      /* Number of used entries + TOMBSTONES */
-  int capacity;   /* Size of the table */
-  Entry* entries; /* Actual entries */
+  uint32_t hash; /* Cached hash of the key, compared before the key itself */
+  int symbol;    /* ID of the entry (-1 if the slot is empty) */
+} Slot;
+
+/* Table structure, entries indexed by their ID and a hash index over their keys */
+typedef struct {
+  int count;      /* Number of keys in the index */
+  int capacity;   /* Number of slots, a power of two */
+  Slot* slots;    /* Hash index, open addressing with Robin Hood probing */
   uint32_t currentAddress; /* Cumulated address of the variables in the table */
+  int symbolCount;    /* Number of IDs given, the keys are numbered from 0 */
+  int symbolCapacity; /* Size of the symbols array */
+  Entry* symbols;     /* Entries indexed by their ID, a removed entry has a NULL key */
 } Table;
 
 /* Table operations */
@@ -36,5 +48,14 @@ bool tableDelete(Table* table, String* key);
 void tableAddAll(Table* from, Table* to);
 void tableSetFromRegister(Table* table, Register* reg);
 bool tableGetToRegister(Table* table, String* key, Register* reg);
+/* Bulk insertion, the key only gets an ID and is found once the table is frozen */
+Entry* tableAppend(Table* table, String* key, Value value, uint32_t address);
+/* Index the appended keys in one pass (a later key replaces an earlier one with the same name),
+   the table is then only read */
+void tableFreeze(Table* table);
+/* ID of the key given by its characters, hashed once (-1 if absent) */
+int tableSymbol(Table* table, const char* chars, int length);
+/* Entry of a given ID, its key is the interned name of the variable */
+Entry* tableEntry(Table* table, int symbol);
 
 #endif
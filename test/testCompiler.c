@@ -13,8 +13,32 @@
 #include "table.h"
 #include "value.h"
 
-void setUp() {}
-void tearDown() {}
+static Disassembler* disassembler;
+static Compiler* compiler;
+static CompileOptions options;
+
+/* Setup and teardown routine, the options hold the defaults and each test sets what it exercises */
+void setUp() {
+  disassembler = initDisassembler(false, stdout);
+  compiler = initCompiler(disassembler);
+  options = (CompileOptions){1, PARTITION_COUNT, 1, "a.out", false, OUTPUT_RAW, false, false, false};
+}
+void tearDown() {
+  freeCompiler(compiler);
+  freeDisassembler(disassembler);
+}
+
+/* Compile the global declarations of a source with the options, the parser stops on the first process */
+static bool declareGlobals(char* source) {
+  initScanner(&compiler->scanner, source);
+  advance(compiler);
+  return globalDeclarations(compiler, &options, NULL);
+}
+
+/* Entry of a global given by its name */
+static Entry* global(const char* name) {
+  return tableEntry(compiler->globals, tableSymbol(compiler->globals, name, (int) strlen(name)));
+}
 
 
 /* ==================================
@@ -168,3 +192,122 @@ void testProcessFailingGuardconditionSemicolon() {
 
 /* Compile routine
 =============== */
+
+/* Compile a process from its offset in the process index, as a worker does */
+void testCompileProcessAt() {
+  char* source = "byte a = 0;\n"
+                 "process P0 guardblock temp bool t_0 = a < 1; guardcondition t_0; effect a = 1;\n"
+                 "process P1 guardblock temp bool t_1 = a < 2; guardcondition t_1; effect a = 2;\n";
+  initScanner(&compiler->scanner, source);
+  advance(compiler);
+  while (!check(compiler, TOKEN_PROCESS)) globalDeclaration(compiler);
+  tableFreeze(compiler->globals);
+  ProcessIndex* processes = indexProcesses(source);
+  freeChunk(compiler->chunk);
+  compileProcessAt(compiler, source, &processes->offsets[1]);
+  TEST_ASSERT_FALSE(compiler->parser.hadError);
+  TEST_ASSERT_EQUAL(TOKEN_EOF, compiler->parser.current.type);
+  TEST_ASSERT_TRUE(compiler->chunk->count > 0);
+  freeProcessIndex(processes);
+}
+
+/* The initial values of the globals are laid out at their addresses, array elements included */
+void testInitialStateImage() {
+  char* source = "bool f = true;\n"
+                 "byte b[3] = {55, 56};\n"
+                 "int i = -2;\n"
+                 "state {a(0), b(1)} P.state = 1;\n"
+                 "bool g[3] = {false, true};\n";
+  TEST_ASSERT_FALSE(declareGlobals(source));
+  uint8_t expected[13] = {1, 55, 56, 56, 0xFE, 0xFF, 0xFF, 0xFF, 1, 0, 0, 1, 1};
+  TEST_ASSERT_EQUAL_UINT32(104, compiler->image->size);
+  TEST_ASSERT_EQUAL_UINT32(13, imageLength(compiler->image));
+  TEST_ASSERT_EQUAL_MEMORY(expected, compiler->image->bytes, 13);
+}
+
+/* The globals are laid out in the order the processes access them, the parser stays on the first process */
+void testReorderGlobals() {
+  char* source = "byte a = 0;\n"
+                 "byte b = 0;\n"
+                 "byte c = 0;\n"
+                 "process P0 guardblock temp bool t_0 = c < 1; guardcondition t_0; effect a = 1;\n";
+  options.reorder = true;
+  TEST_ASSERT_FALSE(declareGlobals(source));
+  TEST_ASSERT_EQUAL(TOKEN_PROCESS, compiler->parser.current.type);
+  TEST_ASSERT_EQUAL_UINT32(0, global("c")->address);
+  TEST_ASSERT_EQUAL_UINT32(8, global("a")->address);
+  TEST_ASSERT_EQUAL_UINT32(16, global("b")->address);
+}
+
+/* The globals no process writes nor indexes are read as immediates and left out of the state vector */
+void testInlineConstants() {
+  char* source = "byte N = 3;\n"
+                 "byte x = 0;\n"
+                 "byte a[2] = {0};\n"
+                 "process P0 guardblock temp bool t_0 = x < N; guardcondition t_0; effect x = N, a[x] = 1;\n";
+  options.inlineConstants = true;
+  TEST_ASSERT_FALSE(declareGlobals(source));
+  TEST_ASSERT_TRUE(global("N")->constant);
+  TEST_ASSERT_FALSE(global("x")->constant);
+  TEST_ASSERT_FALSE(global("a")->constant);
+  TEST_ASSERT_EQUAL_UINT32(24, compiler->globals->currentAddress);
+  Token name = {TOKEN_IDENTIFIER, "N", 1, 1};
+  Operand constant = globalVariable(compiler, &name);
+  TEST_ASSERT_EQUAL(OPERAND_IMM, constant.type);
+  TEST_ASSERT_EQUAL_INT(3, constant.imm);
+}
+
+/* An array based past the range of an immediate gets its base in pieces, their sum is the full base */
+void testIndexedArrayPastImmediate() {
+  char source[1024] = "";
+  for (int i = 0 ; i < 70 ; i++) sprintf(source + strlen(source), "int v%d = 0;\n", i);
+  strcat(source, "byte arr[4] = {0};\n"
+                 "byte k = 0;\n"
+                 "process P0 guardblock temp bool t_0 = k < 4; guardcondition t_0; effect arr[k] = 1;\n");
+  TEST_ASSERT_FALSE(declareGlobals(source));
+  TEST_ASSERT_EQUAL_UINT32(70 * INT_SIZE, global("arr")->address);
+  ProcessIndex* processes = indexProcesses(source);
+  freeChunk(compiler->chunk);
+  compileProcessAt(compiler, source, &processes->offsets[0]);
+  TEST_ASSERT_FALSE(compiler->parser.hadError);
+  /* The size * index product has the index in a register, the base is made of the immediate products and sums */
+  uint32_t base = 0;
+  for (int i = 0 ; i < compiler->chunk->count ; i++) {
+    uint32_t instruction = compiler->chunk->instructions[i];
+    unsigned int op_code = instruction >> 28;
+    unsigned int cfg_mask = (instruction >> 26) & 0b11;
+    unsigned int imma = (instruction >> 11) & MAX_IMM;
+    unsigned int immb = instruction & MAX_IMM;
+    if (op_code == OP_MUL && cfg_mask == CFG_II) base += imma * immb;
+    if (op_code == OP_ADD && cfg_mask == CFG_IR) base += imma;
+  }
+  TEST_ASSERT_EQUAL_UINT32(70 * INT_SIZE, base);
+  freeProcessIndex(processes);
+}
+
+/* Walking the token buffer from a process index gives the same chunk as scanning */
+void testCompileProcessAtToken() {
+  char* source = "byte a = 0;\n"
+                 "process P0 guardblock temp bool t_0 = a < 1; guardcondition t_0; effect a = 1;\n"
+                 "process P1 guardblock temp bool t_1 = a < 2; guardcondition t_1; effect a = 2;\n";
+  TokenBuffer* tokens = tokenizeSource(source);
+  compiler->tokens = tokens;
+  advance(compiler);
+  while (!check(compiler, TOKEN_PROCESS)) globalDeclaration(compiler);
+  tableFreeze(compiler->globals);
+  ProcessIndex* processes = indexTokenProcesses(tokens);
+  freeChunk(compiler->chunk);
+  compiler->tokens = NULL;
+  compileProcessAt(compiler, source, &processes->offsets[1]);
+  Chunk* scanned = compiler->chunk;
+  resetIrProcess(compiler->ir);
+  compiler->tokens = tokens;
+  compileProcessAt(compiler, source, &processes->offsets[1]);
+  TEST_ASSERT_FALSE(compiler->parser.hadError);
+  TEST_ASSERT_EQUAL(TOKEN_EOF, compiler->parser.current.type);
+  TEST_ASSERT_EQUAL_INT(scanned->count, compiler->chunk->count);
+  TEST_ASSERT_EQUAL_MEMORY(scanned->instructions, compiler->chunk->instructions, scanned->count * sizeof(uint32_t));
+  freeChunk(scanned);
+  freeProcessIndex(processes);
+  freeTokenBuffer(tokens);
+}
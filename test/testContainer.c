@@ -0,0 +1,66 @@
+#include <stdio.h>
+
+#include "unity.h"
+#include "container.h"
+#include "container.c"
+#include "mmemory.h"
+
+#define CONTAINER_PATH "testContainer.sdvb"
+
+static uint8_t widths[4] = {1, 8, 16, 3};
+
+/* Setup and teardown routine */
+void setUp() {
+}
+void tearDown() {
+  remove(CONTAINER_PATH);
+}
+
+/* The sections are read back at page aligned offsets, an empty section included */
+void testContainerRoundTrip() {
+  uint32_t first[3] = {1, 2, 3};
+  uint32_t last[1] = {4};
+  Container* container = openContainer(CONTAINER_PATH, 3, 24, widths, 3);
+  TEST_ASSERT_NOT_NULL(container);
+  addSection(container, SECTION_CODE, 0, first, sizeof(first));
+  addSection(container, SECTION_CODE, 1, NULL, 0);
+  addSection(container, SECTION_CODE, 2, last, sizeof(last));
+  TEST_ASSERT_TRUE(closeContainer(container));
+
+  ContainerView view = mapContainer(CONTAINER_PATH);
+  TEST_ASSERT_NOT_NULL(view.header);
+  TEST_ASSERT_EQUAL_UINT32(3, view.header->targetCount);
+  TEST_ASSERT_EQUAL_UINT32(24, view.header->stateSize);
+  TEST_ASSERT_EQUAL_UINT32(ISA_VERSION, view.header->isaVersion);
+  TEST_ASSERT_EQUAL_MEMORY(widths, view.header->typeWidths, 4);
+  TEST_ASSERT_EQUAL_UINT32(3, view.header->sectionCount);
+  for (int i = 0 ; i < 3 ; i++) {
+    TEST_ASSERT_EQUAL_UINT64(0, view.sections[i].offset % CONTAINER_ALIGN);
+    TEST_ASSERT_EQUAL_UINT32(i, view.sections[i].index);
+  }
+  TEST_ASSERT_EQUAL_MEMORY(first, sectionContent(&view, 0), sizeof(first));
+  TEST_ASSERT_EQUAL_UINT64(0, view.sections[1].length);
+  TEST_ASSERT_EQUAL_MEMORY(last, sectionContent(&view, 2), sizeof(last));
+  TEST_ASSERT_EQUAL_size_t(view.sections[2].offset + CONTAINER_ALIGN, view.size);
+  unmapContainer(&view);
+}
+
+/* A section beyond the size of the table fails the container */
+void testContainerTableFull() {
+  uint32_t code[1] = {1};
+  Container* container = openContainer(CONTAINER_PATH, 2, 8, widths, 1);
+  addSection(container, SECTION_CODE, 0, code, sizeof(code));
+  addSection(container, SECTION_CODE, 1, code, sizeof(code));
+  TEST_ASSERT_FALSE(closeContainer(container));
+}
+
+/* A file that is not a container is not mapped */
+void testContainerBadMagic() {
+  FILE* file = fopen(CONTAINER_PATH, "wb");
+  uint32_t raw[8] = {0x10000002, 0, 0, 0, 0, 0, 0, 0};
+  fwrite(raw, sizeof(uint32_t), 8, file);
+  fclose(file);
+  ContainerView view = mapContainer(CONTAINER_PATH);
+  TEST_ASSERT_NULL(view.header);
+  TEST_ASSERT_NULL(view.base);
+}
@@ -0,0 +1,72 @@
+#include <stdio.h>
+
+#include "unity.h"
+#include "image.h"
+#include "image.c"
+#include "chunk.h"
+#include "mmemory.h"
+#include "value.h"
+
+static StateImage* image;
+
+/* Setup and teardown routine */
+void setUp() {
+  image = initStateImage();
+}
+void tearDown() {
+  freeStateImage(image);
+}
+
+void testImageInitialization() {
+  TEST_ASSERT_EQUAL_UINT32(0, image->size);
+  TEST_ASSERT_EQUAL_UINT32(0, imageLength(image));
+  TEST_ASSERT_NULL(image->bytes);
+}
+
+/* A value is stored from its address with the least significant byte first */
+void testSetImageValue() {
+  setImageValue(image, 8, INT_SIZE, INT_VAL(-300));
+  TEST_ASSERT_EQUAL_UINT32(40, image->size);
+  uint8_t expected[5] = {0, 0xD4, 0xFE, 0xFF, 0xFF};
+  TEST_ASSERT_EQUAL_MEMORY(expected, image->bytes, 5);
+  /* Setting it again clears the bits of the previous value */
+  setImageValue(image, 8, INT_SIZE, INT_VAL(1));
+  uint8_t reset[5] = {0, 1, 0, 0, 0};
+  TEST_ASSERT_EQUAL_MEMORY(reset, image->bytes, 5);
+}
+
+/* Values narrower than a byte share it */
+void testSetImageBits() {
+  setImageValue(image, 1, 1, BOOL_VAL(true));
+  setImageValue(image, 4, 3, BYTE_VAL(5));
+  TEST_ASSERT_EQUAL_UINT32(7, image->size);
+  TEST_ASSERT_EQUAL_UINT32(1, imageLength(image));
+  TEST_ASSERT_EQUAL_HEX8(0x52, image->bytes[0]);
+  /* Growing keeps the content and zeroes the new bytes */
+  sizeImage(image, 100);
+  TEST_ASSERT_EQUAL_UINT32(13, imageLength(image));
+  TEST_ASSERT_EQUAL_HEX8(0x52, image->bytes[0]);
+  TEST_ASSERT_EQUAL_HEX8(0, image->bytes[12]);
+}
+
+/* The image file holds the bytes of the image only, the widths go to their own file */
+void testWriteImage() {
+  TEST_ASSERT_FALSE(packedWidths(image));
+  image->widths[typeCfg(VAL_STATE)] = 3;
+  TEST_ASSERT_TRUE(packedWidths(image));
+  setImageValue(image, 0, BYTE_SIZE, BYTE_VAL(7));
+  TEST_ASSERT_TRUE(writeImage(image, "testImage.init"));
+  TEST_ASSERT_TRUE(writeWidths(image, "testImage.widths"));
+  uint8_t content[8];
+  FILE* file = fopen("testImage.init", "rb");
+  TEST_ASSERT_EQUAL_size_t(1, fread(content, 1, sizeof(content), file));
+  fclose(file);
+  TEST_ASSERT_EQUAL_UINT8(7, content[0]);
+  file = fopen("testImage.widths", "rb");
+  TEST_ASSERT_EQUAL_size_t(4, fread(content, 1, sizeof(content), file));
+  fclose(file);
+  remove("testImage.init");
+  remove("testImage.widths");
+  uint8_t widths[4] = {BOOL_SIZE, BYTE_SIZE, INT_SIZE, 3};
+  TEST_ASSERT_EQUAL_MEMORY(widths, content, 4);
+}
@@ -0,0 +1,59 @@
+#include "unity.h"
+#include "ir.h"
+#include "ir.c"
+#include "chunk.h"
+#include "mmemory.h"
+#include "sstring.h"
+
+static IrProcess* process;
+
+/* Setup and teardown routine */
+void setUp() {
+  process = initIrProcess();
+}
+void tearDown() {
+  freeIrProcess(process);
+}
+
+/* Test IR process initialization */
+void testIrProcessInitialization() {
+  TEST_ASSERT_EQUAL_INT(0, process->count);
+  TEST_ASSERT_EQUAL_INT(-1, process->guardIndex);
+  TEST_ASSERT_EQUAL_INT(0, process->tempCount);
+}
+
+/* Test the compiler temporaries naming */
+void testNewTemp() {
+  Operand t0 = newTemp(process);
+  Operand t1 = newTemp(process);
+  TEST_ASSERT_EQUAL_INT(OPERAND_TEMP, t0.type);
+  TEST_ASSERT_EQUAL_STRING("t_#0", t0.name->chars);
+  TEST_ASSERT_EQUAL_STRING("t_#1", t1.name->chars);
+  TEST_ASSERT_FALSE(operandsEqual(t0, t1));
+}
+
+/* Test operations writing and reset */
+void testWriteIrOp() {
+  for (int i = 0 ; i < 20 ; i++) {
+    IrOp op = initIrOp(IR_ASSIGN, i);
+    op.dst = newTemp(process);
+    op.a = immOperand(i);
+    TEST_ASSERT_EQUAL_INT(i, writeIrOp(process, op));
+  }
+  TEST_ASSERT_EQUAL_INT(20, process->count);
+  TEST_ASSERT_EQUAL_INT(19, process->ops[19].a.imm);
+  resetIrProcess(process);
+  TEST_ASSERT_EQUAL_INT(0, process->count);
+  TEST_ASSERT_EQUAL_INT(0, process->tempCount);
+}
+
+/* Test the IDs of the temporaries, numbered after the globals */
+void testNamedTemp() {
+  process->firstTemp = 10;
+  Operand t0 = newTemp(process);
+  Operand x = namedTemp(process, "t_x", 3);
+  TEST_ASSERT_EQUAL_INT(10, t0.symbol);
+  TEST_ASSERT_EQUAL_INT(11, x.symbol);
+  TEST_ASSERT_TRUE(operandsEqual(x, namedTemp(process, "t_x", 3)));
+  TEST_ASSERT_EQUAL_INT(12, symbolCount(process));
+}
@@ -0,0 +1,153 @@
+#include <string.h>
+
+#include "unity.h"
+#include "layout.h"
+#include "layout.c"
+#include "chunk.h"
+#include "image.h"
+#include "mmemory.h"
+#include "sstring.h"
+#include "table.h"
+#include "value.h"
+
+static Table* globals;
+static StateImage* image;
+
+/* Setup and teardown routine */
+void setUp() {
+  globals = initTable();
+  image = initStateImage();
+}
+void tearDown() {
+  for (int i = 0 ; i < globals->symbolCount ; i++) {
+    if (globals->symbols[i].key != NULL) freeString(globals->symbols[i].key);
+  }
+  freeTable(globals);
+  freeStateImage(image);
+}
+
+/* Declare a global at the end of the byte layout, every element with the same value */
+static void declare(const char* name, Value value, int length) {
+  String* key = initString();
+  assignString(key, name, strlen(name));
+  uint32_t width = typeWidth(image, value.type);
+  tableAppend(globals, key, value, globals->currentAddress)->length = length;
+  for (int i = 0 ; i < length ; i++) {
+    setImageValue(image, globals->currentAddress + i * width, width, value);
+  }
+  globals->currentAddress += width * length;
+}
+
+/* Each global takes the bits of its domain, an int keeps its sign bits, an array is aligned on its elements */
+void testPackGlobals() {
+  declare("f", BOOL_VAL(true), 1);
+  declare("i", INT_VAL(-2), 1);
+  int currentState = 3;
+  int stateNumber = 5;
+  declare("s", STATE_VAL(currentState, stateNumber), 1);
+  declare("b", BYTE_VAL(7), 3);
+  tableFreeze(globals);
+  layoutGlobals(globals, image, NULL, true);
+  TEST_ASSERT_EQUAL_UINT32(INT_SIZE, typeWidth(image, VAL_INT));
+  TEST_ASSERT_EQUAL_UINT32(3, typeWidth(image, VAL_STATE));
+  TEST_ASSERT_EQUAL_UINT32(0, tableEntry(globals, 0)->address);
+  TEST_ASSERT_EQUAL_UINT32(32, tableEntry(globals, 1)->address);
+  TEST_ASSERT_EQUAL_UINT32(1, tableEntry(globals, 2)->address);
+  TEST_ASSERT_EQUAL_UINT32(8, tableEntry(globals, 3)->address);
+  TEST_ASSERT_EQUAL_UINT32(64, globals->currentAddress);
+  TEST_ASSERT_EQUAL_UINT32(64, image->size);
+  TEST_ASSERT_EQUAL_UINT32(1, imageBits(image, 0, 1));
+  TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFE, imageBits(image, 32, 32));
+  TEST_ASSERT_EQUAL_UINT32(3, imageBits(image, 1, 3));
+  uint8_t bytes[3] = {7, 7, 7};
+  TEST_ASSERT_EQUAL_MEMORY(bytes, image->bytes + 1, 3);
+}
+
+/* A value that would straddle two words starts the next one */
+void testPackNoStraddle() {
+  declare("f", BOOL_VAL(false), 1);
+  declare("i", INT_VAL(1), 1);
+  declare("j", INT_VAL(2), 1);
+  tableFreeze(globals);
+  layoutGlobals(globals, image, NULL, true);
+  TEST_ASSERT_EQUAL_UINT32(32, tableEntry(globals, 1)->address);
+  TEST_ASSERT_EQUAL_UINT32(64, tableEntry(globals, 2)->address);
+  TEST_ASSERT_EQUAL_UINT32(2, imageBits(image, 64, 32));
+}
+
+/* A declaration given again takes no room */
+void testPackSuperseded() {
+  declare("x", BYTE_VAL(1), 1);
+  declare("x", BYTE_VAL(2), 1);
+  String* superseded = globals->symbols[0].key;
+  tableFreeze(globals);
+  TEST_ASSERT_NULL(globals->symbols[0].key);
+  freeString(superseded);
+  layoutGlobals(globals, image, NULL, true);
+  TEST_ASSERT_EQUAL_UINT32(0, tableEntry(globals, 1)->address);
+  TEST_ASSERT_EQUAL_UINT32(8, globals->currentAddress);
+  TEST_ASSERT_EQUAL_UINT8(2, image->bytes[0]);
+}
+
+/* The globals follow the order of their first access, the ones never accessed come last */
+void testLayoutAccessOrder() {
+  declare("a", BYTE_VAL(1), 1);
+  declare("b", BYTE_VAL(2), 1);
+  declare("c", BYTE_VAL(3), 1);
+  declare("d", BYTE_VAL(4), 1);
+  tableFreeze(globals);
+  AccessOrder* order = initAccessOrder(globals);
+  accessGlobal(order, 2);
+  accessGlobal(order, 0);
+  accessGlobal(order, 2);
+  accessGlobal(order, -1);
+  TEST_ASSERT_EQUAL_INT(2, order->count);
+  layoutGlobals(globals, image, order, false);
+  TEST_ASSERT_EQUAL_INT(4, order->count);
+  TEST_ASSERT_EQUAL_UINT32(8, tableEntry(globals, 0)->address);
+  TEST_ASSERT_EQUAL_UINT32(16, tableEntry(globals, 1)->address);
+  TEST_ASSERT_EQUAL_UINT32(0, tableEntry(globals, 2)->address);
+  TEST_ASSERT_EQUAL_UINT32(24, tableEntry(globals, 3)->address);
+  uint8_t bytes[4] = {3, 1, 2, 4};
+  TEST_ASSERT_EQUAL_MEMORY(bytes, image->bytes, 4);
+  freeAccessOrder(order);
+}
+
+/* A hole left by the alignment of an array takes the next fields that fit in it */
+void testLayoutFillGap() {
+  declare("b", BYTE_VAL(5), 1);
+  declare("a", INT_VAL(9), 2);
+  declare("f", BOOL_VAL(true), 1);
+  tableFreeze(globals);
+  layoutGlobals(globals, image, NULL, true);
+  TEST_ASSERT_EQUAL_UINT32(32, tableEntry(globals, 1)->address);
+  TEST_ASSERT_EQUAL_UINT32(8, tableEntry(globals, 2)->address);
+  TEST_ASSERT_EQUAL_UINT32(96, globals->currentAddress);
+  TEST_ASSERT_EQUAL_UINT32(1, imageBits(image, 8, 1));
+  TEST_ASSERT_EQUAL_UINT32(9, imageBits(image, 64, 32));
+}
+
+/* The single values kept by no process and in the range of an immediate are constants, they take no room */
+void testMarkConstants() {
+  declare("c", BYTE_VAL(3), 1);
+  declare("w", BYTE_VAL(1), 1);
+  declare("n", INT_VAL(-1), 1);
+  declare("l", INT_VAL(MAX_IMM + 1), 1);
+  declare("a", BYTE_VAL(2), 2);
+  declare("k", BYTE_VAL(4), 1);
+  tableFreeze(globals);
+  bool kept[6] = {false, true, false, false, false, false};
+  TEST_ASSERT_EQUAL_INT(2, markConstants(globals, kept));
+  TEST_ASSERT_TRUE(tableEntry(globals, 0)->constant);
+  TEST_ASSERT_FALSE(tableEntry(globals, 1)->constant);
+  TEST_ASSERT_FALSE(tableEntry(globals, 2)->constant);
+  TEST_ASSERT_FALSE(tableEntry(globals, 3)->constant);
+  TEST_ASSERT_FALSE(tableEntry(globals, 4)->constant);
+  TEST_ASSERT_TRUE(tableEntry(globals, 5)->constant);
+  layoutGlobals(globals, image, NULL, false);
+  TEST_ASSERT_EQUAL_UINT32(0, tableEntry(globals, 1)->address);
+  TEST_ASSERT_EQUAL_UINT32(32, tableEntry(globals, 2)->address);
+  TEST_ASSERT_EQUAL_UINT32(8, tableEntry(globals, 4)->address);
+  TEST_ASSERT_EQUAL_UINT32(96, globals->currentAddress);
+  TEST_ASSERT_EQUAL_UINT8(1, image->bytes[0]);
+}
@@ -78,3 +78,34 @@ void testMacros() {
   printf("Bloup address: %p\n", (void *) bloup);
   FREE(bloup);
 }
+
+/* Arena tests
+=========== */
+
+/* Allocations are aligned and do not overlap */
+void testArenaAllocate() {
+  Arena* arena = initArena();
+  char* a = arenaAllocate(arena, 3);
+  int* b = ARENA_ARRAY(arena, int, 4);
+  TEST_ASSERT_EQUAL_INT(0, (uintptr_t)a % 16);
+  TEST_ASSERT_EQUAL_INT(0, (uintptr_t)b % 16);
+  TEST_ASSERT_TRUE((char*)b >= a + 3);
+  /* Larger than a block, a new one is chained */
+  char* big = arenaAllocate(arena, 1 << 20);
+  big[(1 << 20) - 1] = 1;
+  TEST_ASSERT_NOT_NULL(arena->current->next);
+  freeArena(arena);
+}
+
+/* A reset keeps the last block and starts again from its beginning */
+void testArenaReset() {
+  Arena* arena = initArena();
+  arenaAllocate(arena, 100);
+  arenaAllocate(arena, 1 << 20);
+  ArenaBlock* kept = arena->current;
+  resetArena(arena);
+  TEST_ASSERT_EQUAL_PTR(kept, arena->current);
+  TEST_ASSERT_NULL(arena->current->next);
+  TEST_ASSERT_EQUAL_size_t(0, arena->current->used);
+  freeArena(arena);
+}
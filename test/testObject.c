@@ -0,0 +1,97 @@
+#include <stdio.h>
+
+#include "unity.h"
+#include "object.h"
+#include "object.c"
+#include "chunk.h"
+#include "image.h"
+#include "ir.h"
+#include "mmemory.h"
+#include "partition.h"
+#include "sstring.h"
+
+#define OBJECT_PATH "testObject.o"
+
+static Partition* partition;
+static Partition* linked;
+static IrProcess* ir;
+static StateImage* image;
+static StateImage* linkedImage;
+
+/* Setup and teardown routine */
+void setUp() {
+  partition = initPartition(0);
+  linked = initPartition(0);
+  ir = initIrProcess();
+  image = initStateImage();
+  linkedImage = initStateImage();
+  setImageValue(image, 8, BYTE_SIZE, BYTE_VAL(42));
+  image->widths[typeCfg(VAL_STATE)] = 3;
+  sizeImage(image, 24);
+}
+void tearDown() {
+  freeIrProcess(ir);
+  freePartition(partition);
+  freePartition(linked);
+  freeStateImage(image);
+  freeStateImage(linkedImage);
+  remove(OBJECT_PATH);
+}
+
+/* Add a process jumping over its single instruction and writing a global */
+static void process(uint32_t address) {
+  Chunk* chunk = initChunk();
+  writeChunk(chunk, ((uint32_t)OP_JMP << 28) | 2);
+  writeChunk(chunk, (uint32_t)OP_ADD << 28);
+  writeChunk(chunk, (uint32_t)OP_ENDGA << 28);
+  String* name = irName(ir, "g", 1);
+  IrOp op = initIrOp(IR_ASSIGN, 1);
+  op.a = immOperand(1);
+  op.dst = globalOperand(name, 0, address, VAL_BYTE);
+  writeIrOp(ir, op);
+  addProcess(partition, chunk, ir);
+  resetIrProcess(ir);
+}
+
+/* The processes read back are the ones written, their relocations and the image included */
+void testObjectRoundTrip() {
+  process(8);
+  process(16);
+  TEST_ASSERT_TRUE(writeObject(partition, image, OBJECT_PATH));
+  TEST_ASSERT_TRUE(readObject(linked, linkedImage, OBJECT_PATH));
+  TEST_ASSERT_EQUAL_UINT32(24, linkedImage->size);
+  TEST_ASSERT_EQUAL_MEMORY(image->bytes, linkedImage->bytes, 3);
+  TEST_ASSERT_EQUAL_MEMORY(image->widths, linkedImage->widths, TYPE_CODES);
+  TEST_ASSERT_EQUAL_INT(2, linked->count);
+  ProcessCode* read = &linked->processes[1];
+  TEST_ASSERT_EQUAL_INT(3, read->chunk->count);
+  TEST_ASSERT_EQUAL_MEMORY(partition->processes[1].chunk->instructions, read->chunk->instructions, 3 * sizeof(uint32_t));
+  TEST_ASSERT_EQUAL_UINT32(partition->processes[1].cycles, read->cycles);
+  TEST_ASSERT_EQUAL_INT(1, read->relocationCount);
+  TEST_ASSERT_EQUAL_UINT32(0, read->relocations[0]);
+  TEST_ASSERT_EQUAL_INT(1, read->accessCount);
+  TEST_ASSERT_EQUAL_UINT32(16, read->accesses[0].address);
+  TEST_ASSERT_TRUE(read->accesses[0].written);
+}
+
+/* A linked target patches the jump of its second process */
+void testLinkedTarget() {
+  process(8);
+  process(16);
+  TEST_ASSERT_TRUE(writeObject(partition, image, OBJECT_PATH));
+  TEST_ASSERT_TRUE(readObject(linked, linkedImage, OBJECT_PATH));
+  partitionProcesses(linked, 1, PARTITION_COUNT);
+  Chunk* chunk = targetChunk(linked, 0);
+  TEST_ASSERT_EQUAL_HEX32(((uint32_t)OP_JMP << 28) | 5, chunk->instructions[3]);
+  freeChunk(chunk);
+}
+
+/* A file that is not an object is refused */
+void testReadInvalidObject() {
+  FILE* file = fopen(OBJECT_PATH, "wb");
+  uint32_t words[4] = {0xDEADBEEF, OBJECT_VERSION, 1, 0};
+  fwrite(words, sizeof(uint32_t), 4, file);
+  fclose(file);
+  TEST_ASSERT_FALSE(readObject(linked, linkedImage, OBJECT_PATH));
+  TEST_ASSERT_FALSE(readObject(linked, linkedImage, "missing.o"));
+}
@@ -0,0 +1,186 @@
+#include "unity.h"
+#include "optimizer.h"
+#include "optimizer.c"
+#include "chunk.h"
+#include "ir.h"
+#include "mmemory.h"
+#include "sstring.h"
+
+static IrProcess* process;
+
+/* Setup and teardown routine */
+void setUp() {
+  process = initIrProcess();
+  process->firstTemp = 128;
+}
+void tearDown() {
+  freeIrProcess(process);
+}
+
+/* Named global operand, the globals of a test have distinct first letters used as their ID */
+static Operand global(const char* name, ValueType type) {
+  return globalOperand(irName(process, name, strlen(name)), name[0], 0, type);
+}
+
+/* Append a binary operation to a new temporary */
+static Operand binary(unsigned int op_code, bool negated, Operand a, Operand b) {
+  IrOp op = initIrOp(IR_BINARY, 1);
+  op.op_code = op_code;
+  op.negated = negated;
+  op.a = a;
+  op.b = b;
+  op.dst = newTemp(process);
+  writeIrOp(process, op);
+  return op.dst;
+}
+
+/* Append a store of an operand to a global */
+static void store(const char* name, Operand value) {
+  IrOp op = initIrOp(IR_ASSIGN, 1);
+  op.dst = global(name, VAL_BYTE);
+  op.a = value;
+  writeIrOp(process, op);
+}
+
+/* Test the evaluation of immediate operations and the propagation of the result */
+void testFoldImmediates() {
+  Operand t0 = binary(OP_ADD, false, immOperand(3), immOperand(4));
+  Operand t1 = binary(OP_MUL, false, t0, immOperand(2));
+  store("x", t1);
+  foldConstants(process);
+  TEST_ASSERT_EQUAL_INT(1, process->count);
+  TEST_ASSERT_EQUAL_INT(IR_ASSIGN, process->ops[0].type);
+  TEST_ASSERT_TRUE(isImm(process->ops[0].a, 14));
+}
+
+/* Test the algebraic identities */
+void testFoldIdentities() {
+  Operand t0 = binary(OP_AND, false, global("f", VAL_BOOL), immOperand(1));
+  store("x", t0);
+  Operand t1 = binary(OP_ADD, false, immOperand(0), global("b", VAL_BYTE));
+  store("y", t1);
+  foldConstants(process);
+  TEST_ASSERT_EQUAL_INT(IR_ASSIGN, process->ops[0].type);
+  TEST_ASSERT_EQUAL_INT(OPERAND_GLOBAL, process->ops[0].a.type);
+  TEST_ASSERT_EQUAL_STRING("f", process->ops[0].a.name->chars);
+  TEST_ASSERT_EQUAL_STRING("b", process->ops[2].a.name->chars);
+  /* and with an int is bitwise, it is kept */
+  Operand t2 = binary(OP_AND, false, global("i", VAL_INT), immOperand(1));
+  store("z", t2);
+  foldConstants(process);
+  TEST_ASSERT_EQUAL_INT(IR_BINARY, process->ops[4].type);
+}
+
+/* Test the negation pushed into the comparisons */
+void testPushNegation() {
+  /* b >= 2 is b > 1 */
+  Operand t0 = binary(OP_LT, true, global("b", VAL_BYTE), immOperand(2));
+  store("x", t0);
+  /* f != true is f == 0 */
+  Operand t1 = binary(OP_EQ, true, global("f", VAL_BOOL), immOperand(1));
+  store("y", t1);
+  /* b >= 0 can not be expressed with an immediate */
+  Operand t2 = binary(OP_LT, true, global("b", VAL_BYTE), immOperand(0));
+  store("z", t2);
+  foldConstants(process);
+  TEST_ASSERT_EQUAL_UINT(OP_GT, process->ops[0].op_code);
+  TEST_ASSERT_FALSE(process->ops[0].negated);
+  TEST_ASSERT_TRUE(isImm(process->ops[0].b, 1));
+  TEST_ASSERT_EQUAL_UINT(OP_EQ, process->ops[2].op_code);
+  TEST_ASSERT_FALSE(process->ops[2].negated);
+  TEST_ASSERT_TRUE(isImm(process->ops[2].b, 0));
+  TEST_ASSERT_TRUE(process->ops[4].negated);
+}
+
+/* Test the reuse of computed values and loaded elements */
+void testEliminateCommonSubexpressions() {
+  Operand t0 = binary(OP_ADD, false, global("a", VAL_BYTE), global("b", VAL_BYTE));
+  Operand t1 = binary(OP_ADD, false, global("b", VAL_BYTE), global("a", VAL_BYTE));
+  store("x", t0);
+  store("y", t1);
+  /* a is written, a + b has to be computed again */
+  store("a", immOperand(1));
+  Operand t2 = binary(OP_ADD, false, global("a", VAL_BYTE), global("b", VAL_BYTE));
+  store("z", t2);
+  eliminateCommonSubexpressions(process);
+  foldConstants(process);
+  TEST_ASSERT_EQUAL_INT(6, process->count);
+  TEST_ASSERT_TRUE(operandsEqual(process->ops[0].dst, process->ops[2].a));
+  TEST_ASSERT_EQUAL_INT(IR_BINARY, process->ops[4].type);
+}
+
+/* Test the forwarding of a stored element and the aliasing of stores */
+void testForwardStoredElement() {
+  String* array = irName(process, "arr", 3);
+  Operand index = global("i", VAL_BYTE);
+  IrOp storeOp = initIrOp(IR_STORE_ELEM, 1);
+  storeOp.array = array;
+  storeOp.arraySymbol = array->chars[0];
+  storeOp.a = index;
+  storeOp.b = immOperand(7);
+  writeIrOp(process, storeOp);
+  IrOp load = initIrOp(IR_LOAD_ELEM, 1);
+  load.array = array;
+  load.arraySymbol = array->chars[0];
+  load.a = index;
+  load.dst = newTemp(process);
+  writeIrOp(process, load);
+  store("x", load.dst);
+  /* Store to another element of unknown index */
+  IrOp aliasing = initIrOp(IR_STORE_ELEM, 1);
+  aliasing.array = array;
+  aliasing.arraySymbol = array->chars[0];
+  aliasing.a = global("j", VAL_BYTE);
+  aliasing.b = immOperand(3);
+  writeIrOp(process, aliasing);
+  load.a = index;
+  load.array = array;
+  load.dst = newTemp(process);
+  writeIrOp(process, load);
+  store("y", load.dst);
+  eliminateCommonSubexpressions(process);
+  foldConstants(process);
+  TEST_ASSERT_TRUE(isImm(process->ops[1].a, 7));
+  TEST_ASSERT_EQUAL_INT(IR_LOAD_ELEM, process->ops[3].type);
+}
+
+/* Test the removal of unused temporaries and overwritten globals */
+void testEliminateDeadCode() {
+  /* Written before the guard, observed if the effect is skipped */
+  store("x", immOperand(1));
+  Operand cond = binary(OP_LT, false, global("a", VAL_BYTE), immOperand(2));
+  binary(OP_ADD, false, global("a", VAL_BYTE), immOperand(1));
+  IrOp guard = initIrOp(IR_GUARD, 1);
+  guard.a = cond;
+  process->guardIndex = writeIrOp(process, guard);
+  store("x", immOperand(2));
+  store("y", immOperand(3));
+  store("y", global("x", VAL_BYTE));
+  store("x", immOperand(4));
+  eliminateDeadCode(process);
+  TEST_ASSERT_EQUAL_INT(6, process->count);
+  TEST_ASSERT_EQUAL_INT(2, process->guardIndex);
+  TEST_ASSERT_TRUE(isImm(process->ops[3].a, 2));
+  TEST_ASSERT_EQUAL_INT(OPERAND_GLOBAL, process->ops[4].a.type);
+}
+
+/* Test the split of an AND-chain guard in early-exit jumps */
+void testShortCircuitGuard() {
+  Operand t0 = binary(OP_LT, false, global("a", VAL_BYTE), immOperand(2));
+  Operand t1 = binary(OP_EQ, false, global("b", VAL_BYTE), immOperand(1));
+  Operand t2 = binary(OP_AND, false, t0, t1);
+  Operand t3 = binary(OP_AND, false, t2, global("f", VAL_BOOL));
+  IrOp guard = initIrOp(IR_GUARD, 1);
+  guard.a = t3;
+  process->guardIndex = writeIrOp(process, guard);
+  store("x", immOperand(1));
+  shortCircuitGuard(process);
+  eliminateDeadCode(process);
+  /* t0, guard t0, t1, guard t1, guard f, x = 1 */
+  TEST_ASSERT_EQUAL_INT(6, process->count);
+  TEST_ASSERT_EQUAL_INT(IR_GUARD, process->ops[1].type);
+  TEST_ASSERT_EQUAL_INT(IR_GUARD, process->ops[3].type);
+  TEST_ASSERT_EQUAL_INT(IR_GUARD, process->ops[4].type);
+  TEST_ASSERT_EQUAL_STRING("f", process->ops[4].a.name->chars);
+  TEST_ASSERT_EQUAL_INT(4, process->guardIndex);
+}
@@ -60,9 +60,18 @@ static TestStub stubs[38] = {
   {TOKEN_NUMBER,        "250.45",          6}
 };
 
+static Disassembler* disassembler;
+static Compiler* compiler;
+
 /* Setup/Teardown routine */
-void setUp() {}
-void tearDown() {}
+void setUp() {
+  disassembler = initDisassembler(false, stdout);
+  compiler = initCompiler(disassembler);
+}
+void tearDown() {
+  freeCompiler(compiler);
+  freeDisassembler(disassembler);
+}
 
 /* Parsing utilities
 ================= */
@@ -70,19 +79,19 @@ void tearDown() {}
 void testAdvance() {
   for (int i = 0 ; i < 38 ; i++) {
     TestStub currentStub = stubs[i];
-    initScanner(currentStub.source);
-    advance();
-    TEST_ASSERT_EQUAL(currentStub.type, parser.current.type);
+    initScanner(&compiler->scanner, currentStub.source);
+    advance(compiler);
+    TEST_ASSERT_EQUAL(currentStub.type, compiler->parser.current.type);
   }
 }
 
 void testConsume() {
   for (int i = 0 ; i < 38 ; i++) {
     TestStub currentStub = stubs[i];
-    initScanner(currentStub.source);
-    parser.current = scanToken(); // Process a given token
-    consume(currentStub.type, "Type not verified.");
-    TEST_ASSERT_EQUAL(currentStub.type, parser.previous.type);
+    initScanner(&compiler->scanner, currentStub.source);
+    compiler->parser.current = scanToken(&compiler->scanner); // Process a given token
+    consume(compiler, currentStub.type, "Type not verified.");
+    TEST_ASSERT_EQUAL(currentStub.type, compiler->parser.previous.type);
   }
 }
 
@@ -0,0 +1,111 @@
+#include "unity.h"
+#include "partition.h"
+#include "partition.c"
+#include "chunk.h"
+#include "ir.h"
+#include "mmemory.h"
+#include "sstring.h"
+
+static Partition* partition;
+static IrProcess* ir;
+
+/* Setup and teardown routine */
+void setUp() {
+  partition = initPartition(0);
+  ir = initIrProcess();
+}
+void tearDown() {
+  freeIrProcess(ir);
+  freePartition(partition);
+}
+
+/* Add a process of the given number of ALU instructions followed by ENDGA */
+static void process(int length) {
+  Chunk* chunk = initChunk();
+  for (int i = 0 ; i < length ; i++) {
+    writeChunk(chunk, (uint32_t)OP_ADD << 28);
+  }
+  writeChunk(chunk, (uint32_t)OP_ENDGA << 28);
+  addProcess(partition, chunk, ir);
+  resetIrProcess(ir);
+}
+
+/* Append to the IR a copy from a global to another, given by their addresses */
+static void copy(uint32_t from, uint32_t to) {
+  String* name = irName(ir, "g", 1);
+  IrOp op = initIrOp(IR_ASSIGN, 1);
+  op.a = globalOperand(name, from / 8, from, VAL_BYTE);
+  op.dst = globalOperand(name, to / 8, to, VAL_BYTE);
+  writeIrOp(ir, op);
+}
+
+/* Test the cycle estimation of the instruction classes */
+void testEstimateCycles() {
+  Chunk* chunk = initChunk();
+  writeChunk(chunk, (uint32_t)OP_ADD << 28);
+  writeChunk(chunk, (uint32_t)OP_DIV << 28);
+  writeChunk(chunk, ((uint32_t)OP_LOAD << 28) | (LOAD_IMM << 26));
+  writeChunk(chunk, ((uint32_t)OP_LOAD << 28) | (LOAD_ADR << 26));
+  TEST_ASSERT_EQUAL_UINT32(CYCLES_ALU + CYCLES_DIV + CYCLES_ALU + CYCLES_MEMORY, estimateCycles(chunk));
+  freeChunk(chunk);
+}
+
+/* Test the source order split, the first targets taking the remainder */
+void testPartitionByCount() {
+  for (int i = 0 ; i < 5 ; i++) process(1);
+  partitionProcesses(partition, 2, PARTITION_COUNT);
+  TEST_ASSERT_EQUAL_INT(0, partition->processes[2].target);
+  TEST_ASSERT_EQUAL_INT(1, partition->processes[3].target);
+}
+
+/* Test the balance of the estimated cycles */
+void testPartitionByCost() {
+  int lengths[] = {1, 1, 1, 1, 8, 4, 3};
+  for (int i = 0 ; i < 7 ; i++) process(lengths[i]);
+  partitionProcesses(partition, 2, PARTITION_COST);
+  uint32_t loads[2] = {0, 0};
+  for (int i = 0 ; i < partition->count ; i++) {
+    loads[partition->processes[i].target] += partition->processes[i].cycles;
+  }
+  TEST_ASSERT_EQUAL_UINT32(13, loads[0]);
+  TEST_ASSERT_EQUAL_UINT32(13, loads[1]);
+}
+
+/* Test the relocation of the jumps of the concatenated processes */
+void testTargetChunk() {
+  process(2);
+  Chunk* chunk = initChunk();
+  writeChunk(chunk, ((uint32_t)OP_JMP << 28) | (1 << 24) | 2);
+  writeChunk(chunk, (uint32_t)OP_ADD << 28);
+  writeChunk(chunk, (uint32_t)OP_ENDGA << 28);
+  addProcess(partition, chunk, ir);
+  Chunk* target = targetChunk(partition, 0);
+  TEST_ASSERT_EQUAL_INT(6, target->count);
+  TEST_ASSERT_EQUAL_HEX32(((uint32_t)OP_JMP << 28) | (1 << 24) | 5, target->instructions[3]);
+  freeChunk(target);
+}
+
+/* Test the read and write sets recorded from the IR */
+void testAddProcessAccesses() {
+  copy(8, 16);
+  copy(16, 8);
+  process(1);
+  ProcessCode* code = &partition->processes[0];
+  TEST_ASSERT_EQUAL_INT(2, code->accessCount);
+  TEST_ASSERT_TRUE(code->accesses[0].written);
+  TEST_ASSERT_TRUE(code->accesses[1].written);
+}
+
+/* Test the processes sharing written globals are kept on the same target */
+void testPartitionByAffinity() {
+  /* Processes 0 and 2 share a global, 1 and 3 another */
+  uint32_t shared[] = {0, 8, 0, 8};
+  for (int i = 0 ; i < 4 ; i++) {
+    copy(32 + 8 * i, shared[i]);
+    process(2);
+  }
+  partitionProcesses(partition, 2, PARTITION_AFFINITY);
+  TEST_ASSERT_EQUAL_INT(partition->processes[0].target, partition->processes[2].target);
+  TEST_ASSERT_EQUAL_INT(partition->processes[1].target, partition->processes[3].target);
+  TEST_ASSERT_NOT_EQUAL(partition->processes[0].target, partition->processes[1].target);
+}
@@ -26,6 +26,7 @@ void testRegisterInitialization() {
   TEST_ASSERT_TRUE(valuesEqual(NIL_VAL, reg->varValue));
   TEST_ASSERT_EQUAL_INT(3, reg->number);
   TEST_ASSERT_EQUAL_UINT32(0, reg->address);
+  TEST_ASSERT_FALSE(reg->isDirty);
 }
 
 /* Variable loading */
@@ -37,4 +38,19 @@ void testVariableLoading() {
   TEST_ASSERT_TRUE(valuesEqual(INT_VAL(1), reg->varValue));
   TEST_ASSERT_EQUAL_INT(3, reg->number);
   TEST_ASSERT_EQUAL_UINT32(0xFF, reg->address);
+  TEST_ASSERT_FALSE(reg->isDirty);
+}
+
+/* Emptying a written register */
+void testEmptyRegister() {
+  String* name = initString();
+  assignString(name, "P1.state", 8);
+  loadVariable(reg, name, INT_VAL(1), 0xFF);
+  reg->isDirty = true;
+  emptyRegister(reg);
+  TEST_ASSERT_EQUAL(NULL, reg->varName);
+  /* The name is owned by the caller */
+  freeString(name);
+  TEST_ASSERT_EQUAL_UINT32(0, reg->address);
+  TEST_ASSERT_FALSE(reg->isDirty);
 }
@@ -9,6 +9,9 @@ typedef struct {
   char* source;
 } TestStub;
 
+/* Scanner under test */
+static Scanner scanner;
+
 /* Setup and teardown routine */
 void setUp() {}
 void tearDown() {}
@@ -16,7 +19,7 @@ void tearDown() {}
 /* Confirm scanner initialization */
 void testScannerInitialization() {
   char* source = "source string test";
-  initScanner(source);
+  initScanner(&scanner, source);
   TEST_ASSERT_EQUAL_STRING(source, scanner.start);
   TEST_ASSERT_EQUAL_STRING(source, scanner.current);
   TEST_ASSERT_EQUAL_INT(1, scanner.line);
@@ -27,8 +30,8 @@ void testScannerInitialization() {
 
 void testScannerAdvance() {
   char* source = "plip ploup\0";
-  initScanner(source);
-  char outChar = advance();
+  initScanner(&scanner, source);
+  char outChar = advance(&scanner);
   TEST_ASSERT_EQUAL_CHAR('p', outChar);
   TEST_ASSERT_EQUAL_STRING("plip ploup\0", scanner.start);
   TEST_ASSERT_EQUAL_STRING("lip ploup\0", scanner.current);
@@ -36,8 +39,8 @@ void testScannerAdvance() {
 
 void testScannerPeek() {
   char* source = "plip ploup\0";
-  initScanner(source);
-  char outChar = peek();
+  initScanner(&scanner, source);
+  char outChar = peek(&scanner);
   TEST_ASSERT_EQUAL_CHAR('p', outChar);
   TEST_ASSERT_EQUAL_STRING("plip ploup\0", scanner.start);
   TEST_ASSERT_EQUAL_STRING("plip ploup\0", scanner.current);
@@ -45,8 +48,8 @@ void testScannerPeek() {
 
 void testScannerPeekNext() {
   char* source = "plip ploup\0";
-  initScanner(source);
-  char outChar = peekNext();
+  initScanner(&scanner, source);
+  char outChar = peekNext(&scanner);
   TEST_ASSERT_EQUAL_CHAR('l', outChar);
   TEST_ASSERT_EQUAL_STRING("plip ploup\0", scanner.start);
   TEST_ASSERT_EQUAL_STRING("plip ploup\0", scanner.current);
@@ -54,8 +57,8 @@ void testScannerPeekNext() {
 
 void testScannerPeekNextEOF() {
   char* source = "\0";
-  initScanner(source);
-  char outChar = peekNext();
+  initScanner(&scanner, source);
+  char outChar = peekNext(&scanner);
   TEST_ASSERT_EQUAL_CHAR('\0', outChar);
   TEST_ASSERT_EQUAL_STRING("\0", scanner.start);
   TEST_ASSERT_EQUAL_STRING("\0", scanner.current);
@@ -63,12 +66,12 @@ void testScannerPeekNextEOF() {
 
 void testMatch() {
   char* source = "p\0";
-  initScanner(source);
-  bool matchFirst = match('p');
+  initScanner(&scanner, source);
+  bool matchFirst = match(&scanner, 'p');
   TEST_ASSERT_TRUE(matchFirst);
   TEST_ASSERT_EQUAL_STRING("p\0", scanner.start);
   TEST_ASSERT_EQUAL_STRING("\0", scanner.current);
-  bool matchSecond = match('\0');
+  bool matchSecond = match(&scanner, '\0');
   TEST_ASSERT_FALSE(matchSecond);
   TEST_ASSERT_EQUAL_STRING("p\0", scanner.start);
   TEST_ASSERT_EQUAL_STRING("\0", scanner.current);
@@ -77,51 +80,72 @@ void testMatch() {
 
 void testSkipWhiteSpace() {
   char* source = "    \t\n\t\tp // a comment blib bloub\n\0";
-  initScanner(source);
-  skipWhitespace();
-  char outChar = advance();
+  initScanner(&scanner, source);
+  skipWhitespace(&scanner);
+  char outChar = advance(&scanner);
   TEST_ASSERT_EQUAL_CHAR('p', outChar);
   TEST_ASSERT_EQUAL_INT(2, scanner.line);
-  skipWhitespace();
+  skipWhitespace(&scanner);
   TEST_ASSERT_EQUAL_INT(3, scanner.line);
-  TEST_ASSERT_TRUE(isAtEnd());
+  TEST_ASSERT_TRUE(isAtEnd(&scanner));
+}
+
+/* Runs longer than a block, starting at every alignment, give the same tokens and lines */
+void testSkipLongRuns() {
+  const char run[] = "\n\t\t\t\t\t\t\t\t\t\t\t\t  \r\n\n// comment long enough to span two blocks\n"
+                     "\t\t\tP_12.my_place_with_a_long_name_0123456789 123456789012345678901234567890.5";
+  /* Room for the largest shift in front of the run and its terminator */
+  char source[32 + sizeof(run)];
+  for (int shift = 0 ; shift < 32 ; shift++) {
+    memset(source, ' ', shift);
+    strcpy(source + shift, run);
+    initScanner(&scanner, source);
+    Token token = scanToken(&scanner);
+    TEST_ASSERT_EQUAL(TOKEN_IDENTIFIER, token.type);
+    TEST_ASSERT_EQUAL_INT(41, token.length);
+    TEST_ASSERT_EQUAL_INT(5, token.line);
+    token = scanToken(&scanner);
+    TEST_ASSERT_EQUAL(TOKEN_NUMBER, token.type);
+    TEST_ASSERT_EQUAL_INT(32, token.length);
+    TEST_ASSERT_EQUAL(TOKEN_EOF, scanToken(&scanner).type);
+  }
 }
 
 /* Character checks
 ================ */
 void testScannerIsEOFTrue() {
   char* source = "\0";
-  initScanner(source);
-  TEST_ASSERT_TRUE(isAtEnd());
+  initScanner(&scanner, source);
+  TEST_ASSERT_TRUE(isAtEnd(&scanner));
 }
 
 void testScannerIsEOFFalse() {
   char* source = "plip ploup";
-  initScanner(source);
-  TEST_ASSERT_FALSE(isAtEnd());
+  initScanner(&scanner, source);
+  TEST_ASSERT_FALSE(isAtEnd(&scanner));
 }
 
 void testScannerIsAlpha() {
   char* source = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ\0";
-  initScanner(source);
+  initScanner(&scanner, source);
   while (*scanner.current != '\0') {
-    TEST_ASSERT_TRUE(isAlpha(advance()));
+    TEST_ASSERT_TRUE(isAlpha(advance(&scanner)));
   }
 }
 
 void testScannerIsDigit() {
   char* source = "0123456789\0";
-  initScanner(source);
+  initScanner(&scanner, source);
   while (*scanner.current != '\0') {
-    TEST_ASSERT_TRUE(isDigit(advance()));
+    TEST_ASSERT_TRUE(isDigit(advance(&scanner)));
   }
 }
 
 void testScannerIsIDPunctuation() {
   char* source = "_.\0";
-  initScanner(source);
+  initScanner(&scanner, source);
   while (*scanner.current != '\0') {
-    TEST_ASSERT_TRUE(isIDPunctuation(advance()));
+    TEST_ASSERT_TRUE(isIDPunctuation(advance(&scanner)));
   }
 }
 
@@ -130,9 +154,9 @@ void testScannerIsIDPunctuation() {
 
 void testMakeToken() {
   char* source = "plip\0";
-  initScanner(source);
+  initScanner(&scanner, source);
   scanner.current = scanner.current + 4;
-  Token token = makeToken(TOKEN_IDENTIFIER);
+  Token token = makeToken(&scanner, TOKEN_IDENTIFIER);
   TEST_ASSERT_EQUAL(TOKEN_IDENTIFIER, token.type);
   TEST_ASSERT_EQUAL(scanner.start, token.start);
   TEST_ASSERT_EQUAL_INT(4, token.length);
@@ -141,7 +165,7 @@ void testMakeToken() {
 
 void testErrorToken() {
   scanner.line = 10;
-  Token error = errorToken("blip bloup");
+  Token error = errorToken(&scanner, "blip bloup");
   TEST_ASSERT_EQUAL(TOKEN_ERROR, error.type);
   TEST_ASSERT_EQUAL_STRING("blip bloup", error.start);
   TEST_ASSERT_EQUAL_INT(10, error.length);
@@ -153,13 +177,13 @@ void testErrorToken() {
 
 void testCheckKeyword() {
   char* source = "effect";
-  initScanner(source);
+  initScanner(&scanner, source);
   scanner.current = scanner.current + 6;
-  TEST_ASSERT_EQUAL(TOKEN_EFFECT, checkKeyword(1, 5, "ffect", TOKEN_EFFECT));
-  TEST_ASSERT_EQUAL(TOKEN_EFFECT, checkKeyword(2, 4, "fect", TOKEN_EFFECT));
-  TEST_ASSERT_EQUAL(TOKEN_EFFECT, checkKeyword(3, 3, "ect", TOKEN_EFFECT));
-  TEST_ASSERT_EQUAL(TOKEN_EFFECT, checkKeyword(4, 2, "ct", TOKEN_EFFECT));
-  TEST_ASSERT_EQUAL(TOKEN_EFFECT, checkKeyword(5, 1, "t", TOKEN_EFFECT));
+  TEST_ASSERT_EQUAL(TOKEN_EFFECT, checkKeyword(&scanner, 1, 5, "ffect", TOKEN_EFFECT));
+  TEST_ASSERT_EQUAL(TOKEN_EFFECT, checkKeyword(&scanner, 2, 4, "fect", TOKEN_EFFECT));
+  TEST_ASSERT_EQUAL(TOKEN_EFFECT, checkKeyword(&scanner, 3, 3, "ect", TOKEN_EFFECT));
+  TEST_ASSERT_EQUAL(TOKEN_EFFECT, checkKeyword(&scanner, 4, 2, "ct", TOKEN_EFFECT));
+  TEST_ASSERT_EQUAL(TOKEN_EFFECT, checkKeyword(&scanner, 5, 1, "t", TOKEN_EFFECT));
 }
 
 void testIdentifierType() {
@@ -185,16 +209,16 @@ void testIdentifierType() {
 
   for (int i = 0 ; i < 17 ; i++) {
     TestStub currentStub = stubs[i];
-    initScanner(currentStub.source);
-    Token scannedToken = identifier();
+    initScanner(&scanner, currentStub.source);
+    Token scannedToken = identifier(&scanner);
     TEST_ASSERT_EQUAL(currentStub.type, scannedToken.type);
   }
 }
 
 void testIdentifier() {
   char* source = "t_blipbloup240.45wdfs";
-  initScanner(source);
-  Token idToken = identifier();
+  initScanner(&scanner, source);
+  Token idToken = identifier(&scanner);
   TEST_ASSERT_EQUAL(TOKEN_IDENTIFIER, idToken.type);
   TEST_ASSERT_EQUAL_STRING("t_blipbloup240.45wdfs", idToken.start);
   TEST_ASSERT_EQUAL_INT(21, idToken.length);
@@ -202,8 +226,8 @@ void testIdentifier() {
 
 void testNumber() {
   char* source = "356.3742";
-  initScanner(source);
-  Token numToken = number();
+  initScanner(&scanner, source);
+  Token numToken = number(&scanner);
   TEST_ASSERT_EQUAL(TOKEN_NUMBER, numToken.type);
   TEST_ASSERT_EQUAL_STRING("356.3742", numToken.start);
   TEST_ASSERT_EQUAL_INT(8, numToken.length);
@@ -258,8 +282,63 @@ void testScanToken() {
 
   for (int i=0 ; i<39 ; i++) {
     TestStub currentStub = stubs[i];
-    initScanner(currentStub.source);
-    Token scannedToken = scanToken();
+    initScanner(&scanner, currentStub.source);
+    Token scannedToken = scanToken(&scanner);
     TEST_ASSERT_EQUAL(currentStub.type, scannedToken.type);
   }
 }
+
+/* Lookahead: scanning after a copy of the state does not move the restored scanner */
+void testSaveRestoreScanner() {
+  char* source = "P_0.state = 1,\n next = t_1;";
+  initScanner(&scanner, source);
+  scanToken(&scanner);
+  Scanner saved = scanner;
+  Token token;
+  do {
+    token = scanToken(&scanner);
+  } while (token.type != TOKEN_EOF);
+  TEST_ASSERT_EQUAL_INT(2, scanner.line);
+  scanner = saved;
+  token = scanToken(&scanner);
+  TEST_ASSERT_EQUAL(TOKEN_EQUAL, token.type);
+  TEST_ASSERT_EQUAL_INT(1, token.line);
+}
+
+/* Only the 'process' keywords are indexed, with their offset and line */
+void testIndexProcesses() {
+  char* source = "byte processor = 0;\n"
+                 "// process in a comment\n"
+                 "process P0 guardblock processor = 1;\n"
+                 "process P1";
+  ProcessIndex* index = indexProcesses(source);
+  TEST_ASSERT_EQUAL_INT(2, index->count);
+  TEST_ASSERT_EQUAL_INT(3, index->offsets[0].line);
+  TEST_ASSERT_EQUAL_STRING("process P1", source + index->offsets[1].offset);
+  /* A scanner resumes on the 'process' keyword */
+  initScannerAt(&scanner, source, &index->offsets[0]);
+  TEST_ASSERT_EQUAL(TOKEN_PROCESS, scanToken(&scanner).type);
+  TEST_ASSERT_EQUAL_INT(3, scanner.line);
+  freeProcessIndex(index);
+}
+
+/* The buffered tokens are the scanned ones, an error keeps its message */
+void testTokenizeSource() {
+  char* source = "process P0\n  a = ?;";
+  TokenBuffer* tokens = tokenizeSource(source);
+  TEST_ASSERT_EQUAL_INT(7, tokens->count);
+  Token token = tokenAt(tokens, 3);
+  TEST_ASSERT_EQUAL(TOKEN_EQUAL, token.type);
+  TEST_ASSERT_EQUAL_INT(2, token.line);
+  TEST_ASSERT_EQUAL_PTR(source + 15, token.start);
+  token = tokenAt(tokens, 4);
+  TEST_ASSERT_EQUAL(TOKEN_ERROR, token.type);
+  TEST_ASSERT_EQUAL_STRING_LEN("Unexpected character.", token.start, token.length);
+  /* Past the end stays on the EOF */
+  TEST_ASSERT_EQUAL(TOKEN_EOF, tokenAt(tokens, 42).type);
+  ProcessIndex* index = indexTokenProcesses(tokens);
+  TEST_ASSERT_EQUAL_INT(1, index->count);
+  TEST_ASSERT_EQUAL_INT(0, index->offsets[0].token);
+  freeProcessIndex(index);
+  freeTokenBuffer(tokens);
+}
@@ -50,3 +50,12 @@ void testStringEqualFalse() {
   assignString(testString2, "bloup", 5);
   TEST_ASSERT_FALSE(stringsEqual(testString, testString2));
 }
+
+/* Test string copy */
+void testStringCopy() {
+  assignString(testString, "blip", 4);
+  String* copy = copyString(testString);
+  TEST_ASSERT_TRUE(stringsEqual(testString, copy));
+  TEST_ASSERT_FALSE(copy->chars == testString->chars);
+  freeString(copy);
+}
@@ -0,0 +1,70 @@
+#include <stdio.h>
+
+#include "unity.h"
+#include "stream.h"
+#include "stream.c"
+#include "chunk.h"
+#include "mmemory.h"
+#include "partition.h"
+
+static Stream* stream;
+
+/* Setup and teardown routine */
+void setUp() {}
+void tearDown() {
+  freeStream(stream);
+  char outFileName[100];
+  for (int t = 0 ; t < 3 ; t++) {
+    snprintf(outFileName, 100, "testStream.bin.%d", t);
+    remove(outFileName);
+  }
+}
+
+/* Write a process of the given number of ALU instructions followed by ENDGA */
+static void process(int length) {
+  Chunk* chunk = initChunk();
+  for (int i = 0 ; i < length ; i++) {
+    writeChunk(chunk, (uint32_t)OP_ADD << 28);
+  }
+  writeChunk(chunk, (uint32_t)OP_ENDGA << 28);
+  TEST_ASSERT_TRUE(streamProcess(stream, chunk));
+  freeChunk(chunk);
+}
+
+/* Test the source order split, the first targets taking the remainder as in a batch partition */
+void testStreamByCount() {
+  stream = initStream(2, PARTITION_COUNT, 5, "testStream.bin");
+  for (int i = 0 ; i < 5 ; i++) process(1);
+  TEST_ASSERT_EQUAL_INT(3, stream->targets[0].processes);
+  TEST_ASSERT_EQUAL_INT(2, stream->targets[1].processes);
+}
+
+/* Test the online balance, each process going to the least loaded target */
+void testStreamByCost() {
+  stream = initStream(2, PARTITION_COST, 0, "testStream.bin");
+  process(8);
+  process(2);
+  process(2);
+  process(2);
+  TEST_ASSERT_EQUAL_INT(1, stream->targets[0].processes);
+  TEST_ASSERT_EQUAL_INT(3, stream->targets[1].processes);
+  TEST_ASSERT_EQUAL_UINT64(stream->targets[0].cycles, stream->targets[1].cycles);
+}
+
+/* Test the jumps of a process written after another one, relocated by the written length */
+void testStreamRelocation() {
+  stream = initStream(1, PARTITION_COUNT, 2, "testStream.bin");
+  process(2);
+  Chunk* chunk = initChunk();
+  writeChunk(chunk, ((uint32_t)OP_JMP << 28) | 1);
+  writeChunk(chunk, (uint32_t)OP_ENDGA << 28);
+  TEST_ASSERT_TRUE(streamProcess(stream, chunk));
+  freeChunk(chunk);
+  TEST_ASSERT_TRUE(closeStream(stream));
+  FILE* file = fopen("testStream.bin.0", "r");
+  TEST_ASSERT_NOT_NULL(file);
+  uint32_t instructions[5];
+  TEST_ASSERT_EQUAL_INT(5, fread(instructions, sizeof(uint32_t), 5, file));
+  fclose(file);
+  TEST_ASSERT_EQUAL_HEX32(((uint32_t)OP_JMP << 28) | 4, instructions[3]);
+}
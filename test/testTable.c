@@ -1,3 +1,5 @@
+#include <stdio.h>
+
 #include "unity.h"
 #include "mmemory.h"
 #include "register.h"
@@ -10,8 +12,6 @@
 static Table* testTable;
 static String* key1;
 static String* key2;
-static Entry* entry1;
-static Entry* entry2;
 static Register* reg1;
 
 /* Setup and teardown routine */
@@ -19,16 +19,12 @@ void setUp() {
   testTable = initTable();
   key1 = initString();
   key2 = initString();
-  entry1 = initEntry();
-  entry2 = initEntry();
   reg1 = initRegister(3);
 }
 void tearDown() {
   freeTable(testTable);
   freeString(key1);
   freeString(key2);
-  freeEntry(entry1);
-  freeEntry(entry2);
   freeRegister(reg1);
 }
 
@@ -38,35 +34,48 @@ void tearDown() {
 void testTableInitialization() {
   TEST_ASSERT_EQUAL_INT(0, testTable->count);
   TEST_ASSERT_EQUAL_INT(0, testTable->capacity);
-  TEST_ASSERT_EQUAL(NULL, testTable->entries);
+  TEST_ASSERT_EQUAL(NULL, testTable->slots);
+  TEST_ASSERT_EQUAL_INT(0, testTable->symbolCount);
 }
 
-/* Entry lookup
-============ */
+/* Slot lookup
+=========== */
 
-void testFindEntry() {
-  Entry testEntries[8];
+/* Keys with the same home slot are found along the probe sequence */
+void testFindSlot() {
   assignString(key1, "blip1", 5);
   assignString(key2, "blip2", 5);
-  assignEntry(entry1, key1, INT_VAL(1), 0xF);
-  assignEntry(entry2, key2, INT_VAL(2), 0xFF);
-  uint32_t index1 = entry1->key->hash % 8;
-  uint32_t index2 = entry2->key->hash % 8;
-  testEntries[index1] = *entry1;
-  testEntries[index2] = *entry2;
-  Entry* outEntry = findEntry(testEntries, 8, key1);
-  TEST_ASSERT_EQUAL_STRING(entry1->key->chars, outEntry->key->chars);
-  TEST_ASSERT_EQUAL_UINT32(entry1->address, outEntry->address);
-  TEST_ASSERT_TRUE(valuesEqual(entry1->value, outEntry->value));
+  tableSet(testTable, key1, INT_VAL(1), 0xF);
+  tableSet(testTable, key2, INT_VAL(2), 0xFF);
+  /* Force a collision with the home slot of the first key */
+  String* key3 = initString();
+  assignString(key3, "blip3", 5);
+  key3->hash = key1->hash;
+  tableSet(testTable, key3, INT_VAL(3), 0xFFF);
+  Slot* slot = findSlot(testTable, "blip3", 5, key1->hash);
+  TEST_ASSERT_NOT_NULL(slot);
+  TEST_ASSERT_EQUAL_INT(2, slot->symbol);
+  TEST_ASSERT_NULL(findSlot(testTable, "blip4", 5, key1->hash));
+  freeString(key3);
 }
 
 /* Size Operation
 ============== */
 
-void testAdjustCapacityOnCreation() {
-  TEST_ASSERT_EQUAL_INT(0, testTable->capacity);
-  adjustCapacity(testTable, GROW_CAPACITY(testTable->capacity));
-  TEST_ASSERT_EQUAL_INT(8, testTable->capacity);
+void testCapacityIsPowerOfTwo() {
+  char name[8];
+  for (int i = 0 ; i < 100 ; i++) {
+    String* key = initString();
+    assignString(key, name, snprintf(name, 8, "v%d", i));
+    tableSet(testTable, key, BYTE_VAL(i), i);
+  }
+  TEST_ASSERT_EQUAL_INT(100, testTable->count);
+  TEST_ASSERT_EQUAL_INT(0, testTable->capacity & (testTable->capacity - 1));
+  TEST_ASSERT_TRUE(testTable->count <= testTable->capacity * TABLE_MAX_LOAD);
+  TEST_ASSERT_EQUAL_INT(42, tableSymbol(testTable, "v42", 3));
+  for (int i = 0 ; i < 100 ; i++) {
+    freeString(testTable->symbols[i].key);
+  }
 }
 
 /* Table entry manipulation
@@ -76,19 +85,21 @@ void testTableSet() {
   assignString(key1, "blip1", 5);
   Value value = INT_VAL(1);
   uint32_t address = 0xFF;
-  assignEntry(entry1, key1, value, address);
   tableSet(testTable, key1, value, address);
   TEST_ASSERT_EQUAL_INT(8, testTable->capacity);
-  Entry insertedEntry = testTable->entries[key1->hash % 8];
-  TEST_ASSERT_EQUAL_STRING(key1, insertedEntry.key);
-  TEST_ASSERT_TRUE(valuesEqual(value, insertedEntry.value));
-  TEST_ASSERT_EQUAL_UINT32(address, insertedEntry.address);
+  Entry* insertedEntry = tableEntry(testTable, 0);
+  TEST_ASSERT_EQUAL_PTR(key1, insertedEntry->key);
+  TEST_ASSERT_TRUE(valuesEqual(value, insertedEntry->value));
+  TEST_ASSERT_EQUAL_UINT32(address, insertedEntry->address);
+  /* Setting the key again keeps its ID */
+  tableSet(testTable, key1, INT_VAL(2), address);
+  TEST_ASSERT_EQUAL_INT(1, testTable->symbolCount);
+  TEST_ASSERT_TRUE(valuesEqual(INT_VAL(2), insertedEntry->value));
 }
 
 void testTableGet() {
   assignString(key1, "blip1", 5);
   Value value = INT_VAL(1);
-  assignEntry(entry1, key1, value, 0xF);
   Value outValue = NIL_VAL;
   uint32_t outAddress = 0;
   /* Find value with no entry */
@@ -99,13 +110,13 @@ void testTableGet() {
   tableSet(testTable, key1, value, 0xF);
   bool found = tableGet(testTable, key1, &outValue, &outAddress);
   TEST_ASSERT_TRUE(found);
+  TEST_ASSERT_EQUAL_UINT32(0xF, outAddress);
 }
 
 void testTableDelete() {
   assignString(key1, "blip1", 5);
   assignString(key2, "blip2", 5);
   Value value = INT_VAL(1);
-  assignEntry(entry1, key1, value, 0xF);
 
   /* Delete in empty table */
   bool notFound = tableDelete(testTable, key1);
@@ -116,12 +127,26 @@ void testTableDelete() {
   notFound = tableDelete(testTable, key2);
   TEST_ASSERT_FALSE(notFound);
 
-  /* Delete known value*/
+  /* Delete known value, the slot is emptied without a tombstone */
   bool found = tableDelete(testTable, key1);
-  Entry removedEntry = testTable->entries[key1->hash % 8];
   TEST_ASSERT_TRUE(found);
-  TEST_ASSERT_EQUAL(NULL, removedEntry.key);
-  TEST_ASSERT_TRUE(valuesEqual(BOOL_VAL(true), removedEntry.value));
+  TEST_ASSERT_EQUAL_INT(0, testTable->count);
+  TEST_ASSERT_EQUAL_INT(-1, testTable->slots[key1->hash & 7].symbol);
+  TEST_ASSERT_EQUAL(NULL, tableEntry(testTable, 0)->key);
+}
+
+/* Test the declarations appended then indexed by the freeze, a redeclaration replaces the key */
+void testTableFreeze() {
+  assignString(key1, "blip1", 5);
+  assignString(key2, "blip1", 5);
+  tableAppend(testTable, key1, INT_VAL(1), 0);
+  TEST_ASSERT_EQUAL_INT(-1, tableSymbol(testTable, "blip1", 5));
+  tableAppend(testTable, key2, INT_VAL(2), 8);
+  tableFreeze(testTable);
+  TEST_ASSERT_EQUAL_INT(1, testTable->count);
+  TEST_ASSERT_EQUAL_INT(1, tableSymbol(testTable, "blip1", 5));
+  TEST_ASSERT_EQUAL(NULL, tableEntry(testTable, 0)->key);
+  TEST_ASSERT_EQUAL_UINT32(8, tableEntry(testTable, 1)->address);
 }
 
 /* Register to table operations
@@ -135,10 +160,9 @@ void testTableGetToRegister() {
   tableSet(testTable, key1, value, address);
 
   tableGetToRegister(testTable, key1, reg1);
-  TEST_ASSERT_EQUAL_STRING(key1, reg1->varName);
+  TEST_ASSERT_EQUAL_PTR(key1, reg1->varName);
   TEST_ASSERT_TRUE(valuesEqual(value, reg1->varValue));
   TEST_ASSERT_EQUAL_UINT32(address, reg1->address);
-  fprintRegister(reg1);
 }
 
 void testTableSetFromRegister() {
@@ -148,9 +172,8 @@ void testTableSetFromRegister() {
   loadVariable(reg1, key1, value, address);
 
   tableSetFromRegister(testTable, reg1);
-  Entry insertedEntry = testTable->entries[key1->hash % 8];
-  TEST_ASSERT_EQUAL_STRING(reg1->varName, insertedEntry.key);
-  TEST_ASSERT_TRUE(valuesEqual(reg1->varValue, insertedEntry.value));
-  TEST_ASSERT_EQUAL_UINT32(reg1->address, insertedEntry.address);
-  fprintRegister(reg1);
+  Entry* insertedEntry = tableEntry(testTable, 0);
+  TEST_ASSERT_EQUAL_PTR(reg1->varName, insertedEntry->key);
+  TEST_ASSERT_TRUE(valuesEqual(reg1->varValue, insertedEntry->value));
+  TEST_ASSERT_EQUAL_UINT32(reg1->address, insertedEntry->address);
 }